@@ -176,7 +176,8 @@ static double to_dflt0(const char *s) { return (s && *s) ? strtod(s, NULL) : 0.0
 //   A) jedec_hex,spi_hz,avg_erase_ms,...,verify_errors
 //   B) timestamp_ms,jedec_hex,spi_hz,avg_erase_ms,...,verify_errors
 static bool load_bench_12mhz(double *avg_erase_ms, double *avg_write_kBps,
-                             double *avg_readseq_kBps, uint32_t *verify_errors)
+                             double *avg_readseq_kBps, uint32_t *verify_errors,
+                             double *avg_erase32_ms, double *avg_erase64_ms)
 {
     FRESULT fr = f_mount(&g_fs_ana, "0:", 1);
     if (fr != FR_OK) { printf("ERROR: mount err=%d\r\n", fr); return false; }
@@ -198,12 +199,21 @@ static bool load_bench_12mhz(double *avg_erase_ms, double *avg_write_kBps,
     const char *ALT_WK[]    = {"avg_write256_kBps", "avg_write_kBps"};
     const char *ALT_RK[]    = {"avg_readseq_kBps", "avg_read_kBps"};
     const char *ALT_VER[]   = {"verify_errors", "total_verify_errors", "total_verify_errs"};
+    const char *ALT_MODE[]  = {"read_mode"};
+    const char *ALT_E32[]   = {"avg_erase32_ms"};
+    const char *ALT_E64[]   = {"avg_erase64_ms"};
+    const char *ALT_CS[]    = {"cs"};
 
     int i_hz    = find_col_multi(hdr, nh, ALT_HZ,    (int)(sizeof ALT_HZ   /sizeof ALT_HZ[0]));
     int i_erase = find_col_multi(hdr, nh, ALT_ERASE, (int)(sizeof ALT_ERASE/sizeof ALT_ERASE[0]));
     int i_wk    = find_col_multi(hdr, nh, ALT_WK,    (int)(sizeof ALT_WK   /sizeof ALT_WK[0]));
     int i_rk    = find_col_multi(hdr, nh, ALT_RK,    (int)(sizeof ALT_RK   /sizeof ALT_RK[0]));
     int i_ver   = find_col_multi(hdr, nh, ALT_VER,   (int)(sizeof ALT_VER  /sizeof ALT_VER[0]));
+    int i_mode  = find_col_multi(hdr, nh, ALT_MODE,  1);   // optional; older files are all 1-1-1
+    int i_e32   = find_col_multi(hdr, nh, ALT_E32,   1);   // optional block erase columns
+    int i_e64   = find_col_multi(hdr, nh, ALT_E64,   1);
+    int i_cs    = find_col_multi(hdr, nh, ALT_CS,    1);   // optional; older files are all one chip
+    unsigned cs_now = flash_dev_cs_pin(NULL);
 
     if (i_hz < 0 || i_erase < 0 || i_wk < 0 || i_rk < 0 || i_ver < 0) {
         printf("ERROR: benchmark.csv header missing required columns.\r\n");
@@ -225,6 +235,11 @@ static bool load_bench_12mhz(double *avg_erase_ms, double *avg_write_kBps,
         double   r_kB = to_dflt0(col[i_rk]);
         uint32_t verr = (uint32_t)strtoul(col[i_ver], NULL, 10);
 
+        // the reference table is single-lane; skip the PIO dual/quad rows
+        if (i_mode >= 0 && i_mode < n && *col[i_mode] && strcmp(col[i_mode], "1-1-1") != 0) continue;
+        // only rows measured on the selected chip
+        if (i_cs >= 0 && i_cs < n && *col[i_cs] && strtoul(col[i_cs], NULL, 10) != cs_now) continue;
+
         if (hz == 12000000u) {
             // keep the *last* 12 MHz row if there are multiple
             found = true;
@@ -232,6 +247,8 @@ static bool load_bench_12mhz(double *avg_erase_ms, double *avg_write_kBps,
             *avg_write_kBps   = w_kB;
             *avg_readseq_kBps = r_kB;
             *verify_errors    = verr;
+            *avg_erase32_ms   = (i_e32 >= 0 && i_e32 < n) ? to_dflt0(col[i_e32]) : 0.0;
+            *avg_erase64_ms   = (i_e64 >= 0 && i_e64 < n) ? to_dflt0(col[i_e64]) : 0.0;
         }
     }
 
@@ -357,11 +374,56 @@ static int parse_ref_line(const char *line_in, chip_ref_t *out) {
     return 1;
 }
 
+bool chip_ref_seed_timing(void)
+{
+    uint8_t id[3] = {0};
+    read_jedec_id(id);
+    uint16_t dev = (uint16_t)((id[1] << 8) | id[2]);
+
+    FRESULT fr = f_mount(&g_fs_ana, "0:", 1);
+    if (fr != FR_OK) return false;
+
+    FIL f; fr = f_open(&f, REF_PATH, FA_READ);
+    if (fr != FR_OK) { f_unmount("0:"); return false; }
+
+    char line[512];
+    bool found = false;
+    chip_ref_t r;
+    if (f_gets(line, sizeof line, &f)) {          // skip header
+        while (f_gets(line, sizeof line, &f)) {
+            if (line[0] == 0 || line[0] == '\r' || line[0] == '\n') continue;
+            if (!parse_ref_line(line, &r)) continue;
+            if (r.jedec_mfg != id[0]) continue;
+            // some rows only list the capacity byte (e.g. "1F:17")
+            if (r.jedec_dev == dev || (r.jedec_dev <= 0xFF && r.jedec_dev == id[2])) {
+                found = true;
+                break;
+            }
+        }
+    }
+    f_close(&f);
+    f_unmount("0:");
+
+    if (!found) {
+        printf("Timing: JEDEC %02X %02X %02X not in %s, using defaults\r\n",
+               id[0], id[1], id[2], REF_PATH);
+        return false;
+    }
+
+    flash_set_timing(FLASH_WAIT_ERASE_4K, (uint32_t)(r.typ_erase_ms * 1000.0), (uint32_t)(r.max_erase_ms * 1000.0));
+    flash_set_timing(FLASH_WAIT_PROG,     (uint32_t)(r.typ_prog_ms  * 1000.0), (uint32_t)(r.max_prog_ms  * 1000.0));
+    flash_set_timing(FLASH_WAIT_ERASE_32K, (uint32_t)(r.typ_erase32_ms * 1000.0), (uint32_t)(r.max_erase32_ms * 1000.0));
+    flash_set_timing(FLASH_WAIT_ERASE_64K, (uint32_t)(r.typ_erase64_ms * 1000.0), (uint32_t)(r.max_erase64_ms * 1000.0));
+    printf("Timing: %s  erase4K %.0f/%.0f ms  prog %.2f/%.2f ms (typ/max)\r\n",
+           r.model, r.typ_erase_ms, r.max_erase_ms, r.typ_prog_ms, r.max_prog_ms);
+    return true;
+}
+
 void identify_chip_from_bench_12mhz(void)
 {
-    double e_ms=0, w_kBps=0, rseq_kBps=0;
+    double e_ms=0, w_kBps=0, rseq_kBps=0, e32_ms=0, e64_ms=0;
     uint32_t verr=0;
-    if (!load_bench_12mhz(&e_ms, &w_kBps, &rseq_kBps, &verr)) {
+    if (!load_bench_12mhz(&e_ms, &w_kBps, &rseq_kBps, &verr, &e32_ms, &e64_ms)) {
         printf("No 12MHz averages found in %s.\r\n", BENCH_PATH);
         return;
     }
@@ -393,6 +455,7 @@ void identify_chip_from_bench_12mhz(void)
     const double w_erase = 1.0;
     const double w_prog  = 1.0;
     const double w_read  = 0.7;
+    const double w_block = 0.5;     // per block size (32K, 64K)
 
     typedef struct { chip_ref_t ref; double score; } hit_t;
     hit_t best[3]; for (int i=0;i<3;i++){ best[i].score = 1e99; memset(&best[i].ref,0,sizeof(best[i].ref)); }
@@ -415,8 +478,12 @@ void identify_chip_from_bench_12mhz(void)
             ? fabs(read50_mb_s_meas - r.read_50_mb_s) / r.read_50_mb_s
             : 0.0;
 
+        // Block erase terms only when both sides have a number
+        double d_e32 = (e32_ms > 0 && r.typ_erase32_ms > 0) ? fabs(e32_ms - r.typ_erase32_ms) / r.typ_erase32_ms : 0.0;
+        double d_e64 = (e64_ms > 0 && r.typ_erase64_ms > 0) ? fabs(e64_ms - r.typ_erase64_ms) / r.typ_erase64_ms : 0.0;
+
         // Weighted L1 distance
-        double score = w_erase*d_erase + w_prog*d_prog + w_read*d_read;
+        double score = w_erase*d_erase + w_prog*d_prog + w_read*d_read + w_block*(d_e32 + d_e64);
 
         // JEDEC influence: heavy penalty if a row has JEDEC and it doesn't match;
         // small bonus if it does match. If the row has no JEDEC, leave score as-is.
@@ -452,6 +519,8 @@ void identify_chip_from_bench_12mhz(void)
     printf("\r\n=== Chip Identification (12 MHz) ===\r\n");
     printf("Measured: erase=%.2f ms, prog256=%.3f ms, read50~=%.2f MB/s\r\n",
            e_ms, prog_ms_meas, read50_mb_s_meas);
+    if (e32_ms > 0 || e64_ms > 0)
+        printf("          erase32K=%.2f ms, erase64K=%.2f ms\r\n", e32_ms, e64_ms);
     printf("Reference rows accepted: %d\r\n", accepted);
     printf("Top matches:\r\n");
     for (int i=0;i<3;i++){
@@ -467,9 +536,9 @@ void identify_chip_from_bench_12mhz_with_output(printf_func_t out)
 {
     if (!out) out = printf;
 
-    double e_ms=0, w_kBps=0, rseq_kBps=0;
+    double e_ms=0, w_kBps=0, rseq_kBps=0, e32_ms=0, e64_ms=0;
     uint32_t verr=0;
-    if (!load_bench_12mhz(&e_ms, &w_kBps, &rseq_kBps, &verr)) {
+    if (!load_bench_12mhz(&e_ms, &w_kBps, &rseq_kBps, &verr, &e32_ms, &e64_ms)) {
         out("No 12MHz averages found in %s.\r\n", BENCH_PATH);
         return;
     }
@@ -506,6 +575,7 @@ void identify_chip_from_bench_12mhz_with_output(printf_func_t out)
     const double w_erase = 1.0;
     const double w_prog  = 1.0;
     const double w_read  = 0.7;
+    const double w_block = 0.5;     // per block size (32K, 64K)
 
     typedef struct { chip_ref_t ref; double score; } hit_t;
     hit_t best[3];
@@ -525,7 +595,10 @@ void identify_chip_from_bench_12mhz_with_output(printf_func_t out)
             ? fabs(read50_mb_s_meas - r.read_50_mb_s) / r.read_50_mb_s
             : 0.0;
 
-        double score = w_erase*d_erase + w_prog*d_prog + w_read*d_read;
+        double d_e32 = (e32_ms > 0 && r.typ_erase32_ms > 0) ? fabs(e32_ms - r.typ_erase32_ms) / r.typ_erase32_ms : 0.0;
+        double d_e64 = (e64_ms > 0 && r.typ_erase64_ms > 0) ? fabs(e64_ms - r.typ_erase64_ms) / r.typ_erase64_ms : 0.0;
+
+        double score = w_erase*d_erase + w_prog*d_prog + w_read*d_read + w_block*(d_e32 + d_e64);
 
         if (live_mfg || live_dev) {
             if (r.jedec_mfg || r.jedec_dev) {
@@ -558,6 +631,8 @@ void identify_chip_from_bench_12mhz_with_output(printf_func_t out)
     out("\r\n=== Chip Identification (12 MHz) ===\r\n");
     out("Measured: erase=%.2f ms, prog256=%.3f ms, read50~=%.2f MB/s\r\n",
         e_ms, prog_ms_meas, read50_mb_s_meas);
+    if (e32_ms > 0 || e64_ms > 0)
+        out("          erase32K=%.2f ms, erase64K=%.2f ms\r\n", e32_ms, e64_ms);
     out("Reference rows accepted: %d\r\n", accepted);
     out("Top matches:\r\n");
     for (int i=0;i<3;i++){
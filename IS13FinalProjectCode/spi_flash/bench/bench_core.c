@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "bench.h"
+
+// Background benchmark: core 1 runs the fast plan while core 0 keeps
+// serving lwIP, so neither disturbs the other's timing.
+//
+// The flash bus (SPI0) and the card have one owner at a time. Only core 0
+// takes it, for itself or on core 1's behalf, with interrupts off so an
+// lwIP callback can't claim it between the check and the store; core 1
+// only hands its claim back when the run is over.
+//
+// Core 0 -> core 1: one word per run through the SIO FIFO.
+// Core 1 -> core 0: shared state below, written only by core 1 while a run
+// is active. Each writer publishes with a __dmb() before the word the
+// reader checks, so nothing needs a lock. Core 1 never pushes into the
+// FIFO: core 0 would have to drain it.
+
+#ifndef BENCH_CORE_RESULTS_BYTES
+#  define BENCH_CORE_RESULTS_BYTES 6144u   // fits the web output buffer
+#endif
+
+#define BENCH_CMD_RUN 0xBE0C0001u
+
+enum { BENCH_IDLE, BENCH_RUNNING, BENCH_COMPLETE };
+
+static volatile uint32_t s_state = BENCH_IDLE;
+static volatile flash_bus_owner_t s_bus_owner = FLASH_BUS_FREE;
+static volatile uint32_t s_progress;        // percent
+static bool s_core1_up;
+static bench_plan_t s_plan;                 // core 0 fills it before BENCH_CMD_RUN
+
+// Status line: seqlock, odd while core 1 is rewriting it
+static volatile uint32_t s_status_seq;
+static char s_status[64] = "Idle";
+
+// Results: append-only during a run; s_results_len is the published part
+static char s_results[BENCH_CORE_RESULTS_BYTES];
+static volatile uint32_t s_results_len;
+
+bool flash_bus_acquire(flash_bus_owner_t who) {
+    uint32_t irq = save_and_disable_interrupts();
+    bool ok = (s_bus_owner == FLASH_BUS_FREE);
+    if (ok) s_bus_owner = who;
+    restore_interrupts(irq);
+    return ok;
+}
+
+void flash_bus_release(flash_bus_owner_t who) {
+    uint32_t irq = save_and_disable_interrupts();
+    if (s_bus_owner == who) s_bus_owner = FLASH_BUS_FREE;
+    restore_interrupts(irq);
+}
+
+flash_bus_owner_t flash_bus_owner(void) {
+    return s_bus_owner;
+}
+
+static void set_status(const char *fmt, ...) {
+    s_status_seq++;
+    __dmb();
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(s_status, sizeof s_status, fmt, ap);
+    va_end(ap);
+    __dmb();
+    s_status_seq++;
+}
+
+// printf_func_t for bench_run_plan() on core 1
+static void results_out(const char *fmt, ...) {
+    uint32_t len = s_results_len;
+    if (len >= sizeof s_results - 1) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(s_results + len, sizeof s_results - len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    len += (uint32_t)n;
+    if (len > sizeof s_results - 1) len = sizeof s_results - 1;
+    __dmb();
+    s_results_len = len;
+}
+
+static void core1_progress(uint32_t done, uint32_t total, uint32_t hz) {
+    s_progress = total ? done * 100u / total : 0;
+    set_status("Testing @ %u Hz (%u/%u trials)...", hz, done, total);
+}
+
+static void core1_main(void) {
+    for (;;) {
+        if (multicore_fifo_pop_blocking() != BENCH_CMD_RUN) continue;
+
+        uint64_t t0 = time_us_64();
+        bench_set_progress_hook(core1_progress);
+        // Nothing else sleeps on core 1, so the plan may
+        bench_run_plan(&s_plan, 0, false, false, true, results_out);
+        bench_set_progress_hook(NULL);
+        results_out("Core 1 run time: %.1f ms\r\n", (time_us_64() - t0) / 1000.0);
+
+        set_status("Complete");
+        s_progress = 100;
+        __dmb();
+        s_state = BENCH_COMPLETE;
+        s_bus_owner = FLASH_BUS_FREE;       // core 0 never changes it while core 1 holds it
+    }
+}
+
+void init_benchmark_core(void) {
+    if (s_core1_up) return;
+    multicore_launch_core1(core1_main);
+    s_core1_up = true;
+}
+
+bool start_benchmark(void) {
+    if (!flash_bus_acquire(FLASH_BUS_CORE1)) return false;
+    init_benchmark_core();
+
+    // Core 1 is parked in the FIFO pop, so core 0 owns everything here.
+    // The plan file (if any) is read now: FatFs stays on core 0.
+    s_results_len = 0;
+    s_results[0] = '\0';
+    s_plan = *bench_plan_for("fast", &bench_plan_fast, results_out);
+    s_progress = 0;
+    set_status("Starting...");
+    __dmb();
+    s_state = BENCH_RUNNING;
+    multicore_fifo_push_blocking(BENCH_CMD_RUN);
+    return true;
+}
+
+bool is_benchmark_running(void) {
+    return s_state == BENCH_RUNNING;
+}
+
+bool is_benchmark_complete(void) {
+    return s_state == BENCH_COMPLETE;
+}
+
+int get_benchmark_progress(void) {
+    return (int)s_progress;
+}
+
+void get_benchmark_status(char *out, size_t len) {
+    if (!out || !len) return;
+    uint32_t seq;
+    do {
+        while ((seq = s_status_seq) & 1u) tight_loop_contents();
+        __dmb();
+        strncpy(out, s_status, len - 1);
+        out[len - 1] = '\0';
+        __dmb();
+    } while (seq != s_status_seq);
+}
+
+// Whatever core 1 has published so far; the full log once complete.
+void get_benchmark_results(char *out, size_t len) {
+    if (!out || !len) return;
+    uint32_t n = s_results_len;
+    __dmb();
+    if (n > len - 1) n = (uint32_t)(len - 1);
+    memcpy(out, s_results, n);
+    out[n] = '\0';
+}
+
+void reset_benchmark(void) {
+    if (s_state == BENCH_RUNNING) return;
+    s_state = BENCH_IDLE;
+    s_progress = 0;
+    set_status("Idle");
+}
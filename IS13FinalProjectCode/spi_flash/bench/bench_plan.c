@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <strings.h>
+#include "ff.h"
+#include "bench_plan.h"
+
+// Plan files: parsed into a scratch copy, so a bad file leaves the
+// built-in plan in place.
+
+static const char *const OP_NAMES[PLAN_OPS] = {
+    "PROBE", "PREERASE", "ERASE", "PROG", "READ", "READ_MODES", "READ_ERASE", "READ_CURVE"
+};
+static const char *const PAT_NAMES[PLAN_PATS]   = { "-", "ramp", "mix", "zero", "random" };
+static const char *const ADDR_NAMES[PLAN_ADDRS] = { "rotate", "follow", "base", "random" };
+static const char *const KIND_NAMES[3]          = { "once", "trial", "clock" };
+
+static FATFS g_fs_plan;     // only used when nothing else has the card mounted
+
+const char *bench_plan_op_name(plan_op_t op) {
+    return (op < PLAN_OPS) ? OP_NAMES[op] : "?";
+}
+
+void bench_plan_path(char *out, unsigned len, const char *name) {
+    snprintf(out, len, "%s/plan_%s.csv", BENCH_PLAN_DIR, name);
+}
+
+void bench_plan_step_name(const plan_step_t *s, char *out, unsigned len) {
+    if (s->size >= 1024u && (s->size % 1024u) == 0)
+        snprintf(out, len, "%s_%uK", bench_plan_op_name(s->op), (unsigned)(s->size / 1024u));
+    else
+        snprintf(out, len, "%s_%uB", bench_plan_op_name(s->op), (unsigned)s->size);
+}
+
+static int lookup(const char *s, const char *const *names, int n) {
+    for (int i = 0; i < n; ++i) if (!strcasecmp(s, names[i])) return i;
+    return -1;
+}
+
+static void trim(char *s) {
+    char *p = s;
+    while (*p && isspace((unsigned char)*p)) p++;
+    if (p != s) memmove(s, p, strlen(p) + 1);
+    size_t n = strlen(s);
+    while (n && isspace((unsigned char)s[n - 1])) s[--n] = 0;
+}
+
+// Split on commas in place; fields come back trimmed.
+static int split(char *line, char *col[], int max) {
+    int n = 0;
+    char *start = line;
+    for (char *c = line; ; ++c) {
+        if (*c == ',' || *c == '\0') {
+            bool end = (*c == '\0');
+            *c = '\0';
+            if (n < max) { trim(start); col[n++] = start; }
+            if (end) break;
+            start = c + 1;
+        }
+    }
+    return n;
+}
+
+static bool to_u32(const char *s, uint32_t *v) {
+    char *end = NULL;
+    if (!*s) return false;
+    unsigned long x = strtoul(s, &end, 0);
+    if (*end) return false;
+    *v = (uint32_t)x;
+    return true;
+}
+
+// One step: kind, op, size, clock, pattern, reps, addr[, name]
+static bool parse_step(char *col[], int n, plan_step_t *s) {
+    int kind = lookup(col[0], KIND_NAMES, 3);
+    int op   = (n > 1) ? lookup(col[1], OP_NAMES, PLAN_OPS) : -1;
+    if (kind < 0 || op < 0 || n < 7) return false;
+
+    uint32_t size = 0, hz = 0, reps = 0;
+    if (!to_u32(col[2], &size)) return false;
+    if (strcasecmp(col[3], "sweep") != 0 && !to_u32(col[3], &hz)) return false;
+    int pat  = lookup(col[4], PAT_NAMES, PLAN_PATS);
+    int addr = lookup(col[6], ADDR_NAMES, PLAN_ADDRS);
+    if (!to_u32(col[5], &reps) || reps == 0 || reps > 0xFFFFu || pat < 0 || addr < 0) return false;
+
+    switch ((plan_op_t)op) {
+    case PLAN_OP_ERASE:
+        if (size != 4096u && size != 32u * 1024u && size != 64u * 1024u) return false;
+        break;
+    case PLAN_OP_PROG:
+        if (size == 0 || size > BENCH_PLAN_MAX_PROG || pat == PLAN_PAT_NONE) return false;
+        break;
+    case PLAN_OP_READ:
+    case PLAN_OP_READ_MODES:
+        if (size == 0) return false;
+        break;
+    case PLAN_OP_READ_CURVE:
+        if (size < 16u) return false;
+        break;
+    default:
+        break;
+    }
+
+    memset(s, 0, sizeof *s);
+    s->kind    = (plan_kind_t)kind;
+    s->op      = (plan_op_t)op;
+    s->size    = size;
+    s->hz      = hz;
+    s->pattern = (plan_pattern_t)pat;
+    s->reps    = (uint16_t)reps;
+    s->addr    = (plan_addr_t)addr;
+    if (n > 7 && *col[7]) snprintf(s->name, sizeof s->name, "%s", col[7]);
+    else                  bench_plan_step_name(s, s->name, sizeof s->name);
+    return true;
+}
+
+static bool parse_line(char *line, bench_plan_t *p) {
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    trim(line);
+    if (!*line) return true;
+
+    char *col[12];
+    int n = split(line, col, 12);
+    uint32_t v = 0;
+
+    if (!strcasecmp(col[0], "title")) {
+        if (n < 2) return false;
+        snprintf(p->title, sizeof p->title, "%s", col[1]);
+    } else if (!strcasecmp(col[0], "clocks")) {
+        p->n_clocks = 0;
+        for (int i = 1; i < n; ++i) {
+            if (p->n_clocks == BENCH_PLAN_MAX_CLOCKS || !to_u32(col[i], &v) || v == 0) return false;
+            p->clocks[p->n_clocks++] = v;
+        }
+    } else if (!strcasecmp(col[0], "trials")) {
+        if (n < 2 || !to_u32(col[1], &v) || v > 0xFFFFu) return false;
+        p->trials = (uint16_t)v;
+    } else if (!strcasecmp(col[0], "rotate")) {
+        if (n < 2 || !to_u32(col[1], &v) || v > 0xFFFFu) return false;
+        p->rotate = (uint16_t)v;
+    } else if (!strcasecmp(col[0], "progress")) {
+        if (n < 2 || !to_u32(col[1], &v) || v > 0xFFFFu) return false;
+        p->progress = (uint16_t)v;
+    } else {
+        if (p->n_steps == BENCH_PLAN_MAX_STEPS) return false;
+        if (!parse_step(col, n, &p->steps[p->n_steps])) return false;
+        p->n_steps++;
+    }
+    return true;
+}
+
+// f_open that mounts the card itself when nobody else has (the CSV logger
+// may hold it mounted with files open; mounting again would orphan those).
+static FRESULT plan_open(FIL *f, const char *path, BYTE mode, bool *mounted) {
+    *mounted = false;
+    FRESULT fr = f_open(f, path, mode);
+    if (fr != FR_NOT_ENABLED) return fr;
+    fr = f_mount(&g_fs_plan, "0:", 1);
+    if (fr != FR_OK) return fr;
+    *mounted = true;
+    fr = f_open(f, path, mode);
+    if (fr != FR_OK) { f_unmount("0:"); *mounted = false; }
+    return fr;
+}
+
+int bench_plan_load(const char *path, bench_plan_t *plan) {
+    static bench_plan_t tmp;
+    FIL f;
+    bool mounted;
+    if (plan_open(&f, path, FA_READ, &mounted) != FR_OK) return -1;
+
+    memset(&tmp, 0, sizeof tmp);
+    snprintf(tmp.title, sizeof tmp.title, "%s", plan->title);
+    char line[160];
+    int lineno = 0, bad = 0;
+    while (!bad && f_gets(line, sizeof line, &f)) {
+        lineno++;
+        if (!parse_line(line, &tmp)) bad = lineno;
+    }
+    f_close(&f);
+    if (mounted) f_unmount("0:");
+
+    if (!bad && (tmp.n_clocks == 0 || tmp.n_steps == 0)) bad = lineno + 1;   // incomplete
+    if (bad) return bad;
+    *plan = tmp;
+    return 0;
+}
+
+bool bench_plan_save(const char *path, const bench_plan_t *plan) {
+    FIL f;
+    bool mounted;
+    f_mkdir(BENCH_PLAN_DIR);
+    if (plan_open(&f, path, FA_CREATE_ALWAYS | FA_WRITE, &mounted) != FR_OK) return false;
+
+    char line[160];
+    UINT bw = 0;
+    bool ok = true;
+    int n = snprintf(line, sizeof line,
+                     "# kind,op,size,clock,pattern,reps,addr,name\r\ntitle,%s\r\nclocks", plan->title);
+    ok &= f_write(&f, line, (UINT)n, &bw) == FR_OK;
+    for (unsigned i = 0; i < plan->n_clocks; ++i) {
+        n = snprintf(line, sizeof line, ",%u", (unsigned)plan->clocks[i]);
+        ok &= f_write(&f, line, (UINT)n, &bw) == FR_OK;
+    }
+    n = snprintf(line, sizeof line, "\r\ntrials,%u\r\nrotate,%u\r\nprogress,%u\r\n",
+                 (unsigned)plan->trials, (unsigned)plan->rotate, (unsigned)plan->progress);
+    ok &= f_write(&f, line, (UINT)n, &bw) == FR_OK;
+    for (unsigned i = 0; i < plan->n_steps; ++i) {
+        const plan_step_t *s = &plan->steps[i];
+        char hz[12];
+        if (s->hz) snprintf(hz, sizeof hz, "%u", (unsigned)s->hz);
+        else       snprintf(hz, sizeof hz, "sweep");
+        n = snprintf(line, sizeof line, "%s,%s,%u,%s,%s,%u,%s,%s\r\n",
+                     KIND_NAMES[s->kind], OP_NAMES[s->op], (unsigned)s->size, hz,
+                     PAT_NAMES[s->pattern], (unsigned)s->reps, ADDR_NAMES[s->addr], s->name);
+        ok &= f_write(&f, line, (UINT)n, &bw) == FR_OK;
+    }
+    ok &= f_close(&f) == FR_OK;
+    if (mounted) f_unmount("0:");
+    return ok;
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "ff.h"
+#include "flash.h"
+#include "clock_tune.h"
+#include "config.h"
+
+#ifndef SCRATCH_BASE
+#  define SCRATCH_BASE 0x000000u        // same scratch area as bench.c
+#endif
+#ifndef CLOCK_TUNE_PATH
+#  define CLOCK_TUNE_PATH "0:/pico_test/clock_tune.csv"
+#endif
+#ifndef CLOCK_TUNE_TRANSFERS
+#  define CLOCK_TUNE_TRANSFERS 32
+#endif
+
+#define TUNE_REGION    (16u * 1024u)    // four sectors: 64 pages, one per program transfer
+#define TUNE_MAX_XFER  512u
+#define TUNE_MAX_ROWS  16u
+
+static FATFS g_fs_tune;
+
+typedef enum { TUNE_READ, TUNE_PROG } tune_op_t;
+
+static inline uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    *s = x; return x;
+}
+
+// Divider step k: clk_peri / 2k, the only clocks the SPI block can make
+// near the top (prescale 2, postdiv k).
+static uint32_t step_hz(uint32_t k) {
+    return clock_get_hz(clk_peri) / (2u * k);
+}
+
+// Bytes that differ at 'hz' over 'n' randomized transfers; the floor clock
+// gives the reference each time.
+static uint32_t tune_errors(tune_op_t op, uint32_t hz, uint32_t floor_hz, uint32_t n, uint32_t seed) {
+    static uint8_t want[TUNE_MAX_XFER], got[TUNE_MAX_XFER];
+    uint32_t pg = flash_page_size();
+    uint32_t bad = 0;
+
+    if (op == TUNE_PROG) {
+        flash_set_clock(floor_hz);
+        for (uint32_t a = 0; a < TUNE_REGION; a += 4096u) sector_erase_4k(SCRATCH_BASE + a);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t len, addr;
+        if (op == TUNE_PROG) {
+            // own page per transfer, random slice of it, random bytes
+            uint32_t page = i % (TUNE_REGION / pg);
+            len  = 1u + xorshift32(&seed) % (pg < TUNE_MAX_XFER ? pg : TUNE_MAX_XFER);
+            addr = SCRATCH_BASE + page * pg + xorshift32(&seed) % (pg - len + 1u);
+            for (uint32_t b = 0; b < len; b++) want[b] = (uint8_t)xorshift32(&seed);
+            flash_set_clock(hz);
+            page_program(addr, want, len);
+            flash_set_clock(floor_hz);
+            read_data(addr, got, len);
+        } else {
+            len  = 1u + xorshift32(&seed) % TUNE_MAX_XFER;
+            addr = SCRATCH_BASE + xorshift32(&seed) % (TUNE_REGION - len + 1u);
+            flash_set_clock(floor_hz);
+            read_data(addr, want, len);
+            flash_set_clock(hz);
+            read_data(addr, got, len);
+            bad += flash_verify(addr, want, len);   // the CRC path (DMA sniffer) at speed too
+        }
+        for (uint32_t b = 0; b < len; b++) bad += want[b] != got[b];
+    }
+    flash_set_clock(floor_hz);
+    return bad;
+}
+
+// Fastest divider step with no errors, assuming anything slower passes too.
+// 0 when even the floor fails.
+static uint32_t tune_search(tune_op_t op, const char *name, uint32_t floor_hz, uint32_t n,
+                            uint32_t *req_hz, printf_func_t out) {
+    uint32_t lo = 1u, hi = (clock_get_hz(clk_peri) / 2u + floor_hz - 1u) / floor_hz;  // step_hz(hi) <= floor
+    if (hi < 1u) hi = 1u;
+    uint32_t seed = 0x7E57C10Cu ^ (uint32_t)op;
+
+    uint32_t bad = tune_errors(op, step_hz(hi), floor_hz, n, seed);
+    out("  %s @ %u Hz: %u bad byte(s)\r\n", name, (unsigned)flash_set_clock(step_hz(hi)), (unsigned)bad);
+    if (bad) { *req_hz = 0; return 0; }
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2u;
+        uint32_t hz  = step_hz(mid);
+        bad = tune_errors(op, hz, floor_hz, n, seed ^ mid);
+        out("  %s @ %u Hz: %u bad byte(s)\r\n", name, (unsigned)flash_set_clock(hz), (unsigned)bad);
+        if (bad) lo = mid + 1u;
+        else     hi = mid;
+    }
+    *req_hz = step_hz(hi);
+    uint32_t actual = flash_set_clock(*req_hz);
+    flash_set_clock(floor_hz);
+    return actual;
+}
+
+bool clock_tune_run(clock_tune_t *res, printf_func_t out) {
+    uint32_t prev_hz = flash_get_clock();
+    uint32_t floor_hz = SPI_FREQ_HZ;
+    memset(res, 0, sizeof *res);
+    res->transfers = CLOCK_TUNE_TRANSFERS;
+
+    out("Clock search: %u transfers per step, floor %u Hz, ceiling %u Hz\r\n",
+        (unsigned)res->transfers, (unsigned)floor_hz, (unsigned)step_hz(1));
+    // Programs first: they leave random data for the read search to check
+    res->prog_hz = tune_search(TUNE_PROG, "prog", floor_hz, res->transfers, &res->prog_req_hz, out);
+    res->read_hz = tune_search(TUNE_READ, "read", floor_hz, res->transfers, &res->read_req_hz, out);
+    flash_set_clock(prev_hz);
+
+    out("Max reliable read: %u Hz (asked %u)\r\n", (unsigned)res->read_hz, (unsigned)res->read_req_hz);
+    out("Max reliable prog: %u Hz (asked %u)\r\n", (unsigned)res->prog_hz, (unsigned)res->prog_req_hz);
+    return res->read_hz && res->prog_hz;
+}
+
+// ------------------ clock_tune.csv ------------------
+
+static FRESULT tune_open(FIL *f, BYTE mode, bool *mounted) {
+    *mounted = false;
+    FRESULT fr = f_open(f, CLOCK_TUNE_PATH, mode);
+    if (fr != FR_NOT_ENABLED) return fr;
+    fr = f_mount(&g_fs_tune, "0:", 1);
+    if (fr != FR_OK) return fr;
+    *mounted = true;
+    fr = f_open(f, CLOCK_TUNE_PATH, mode);
+    if (fr != FR_OK) { f_unmount("0:"); *mounted = false; }
+    return fr;
+}
+
+static void jedec_hex(char out[7], const uint8_t id[3]) {
+    snprintf(out, 7, "%02X%02X%02X", id[0], id[1], id[2]);
+}
+
+bool clock_tune_load(const uint8_t id[3], clock_tune_t *res) {
+    FIL f;
+    bool mounted;
+    if (tune_open(&f, FA_READ, &mounted) != FR_OK) return false;
+    char key[7], line[96];
+    jedec_hex(key, id);
+    bool found = false;
+    while (!found && f_gets(line, sizeof line, &f)) {
+        unsigned rq, ra, pq, pa, n;
+        char jd[8];
+        if (sscanf(line, "%7[0-9A-Fa-f],%u,%u,%u,%u,%u", jd, &rq, &ra, &pq, &pa, &n) != 6) continue;  // header too
+        if (strcmp(jd, key) != 0) continue;
+        res->read_req_hz = rq; res->read_hz = ra;
+        res->prog_req_hz = pq; res->prog_hz = pa;
+        res->transfers = n;
+        found = true;
+    }
+    f_close(&f);
+    if (mounted) f_unmount("0:");
+    return found;
+}
+
+bool clock_tune_save(const uint8_t id[3], const clock_tune_t *res) {
+    static char keep[TUNE_MAX_ROWS][96];
+    unsigned n_keep = 0;
+    char key[7];
+    jedec_hex(key, id);
+
+    FIL f;
+    bool mounted;
+    if (tune_open(&f, FA_READ, &mounted) == FR_OK) {     // other chips' rows stay
+        char line[96];
+        while (n_keep < TUNE_MAX_ROWS - 1u && f_gets(line, sizeof line, &f)) {
+            if (!strncmp(line, key, 6) || !strncmp(line, "jedec", 5) || line[0] < '0') continue;
+            snprintf(keep[n_keep++], sizeof keep[0], "%s", line);
+        }
+        f_close(&f);
+        if (mounted) f_unmount("0:");
+    }
+
+    f_mkdir(SD_DIR);
+    if (tune_open(&f, FA_CREATE_ALWAYS | FA_WRITE, &mounted) != FR_OK) return false;
+    static const char hdr[] = "jedec_hex,read_req_hz,read_hz,prog_req_hz,prog_hz,transfers,clk_peri_hz\r\n";
+    UINT bw = 0;
+    bool ok = f_write(&f, hdr, sizeof hdr - 1u, &bw) == FR_OK;
+    for (unsigned i = 0; i < n_keep; i++)
+        ok &= f_write(&f, keep[i], (UINT)strlen(keep[i]), &bw) == FR_OK;
+    char line[96];
+    int n = snprintf(line, sizeof line, "%s,%u,%u,%u,%u,%u,%u\r\n", key,
+                     (unsigned)res->read_req_hz, (unsigned)res->read_hz,
+                     (unsigned)res->prog_req_hz, (unsigned)res->prog_hz,
+                     (unsigned)res->transfers, (unsigned)clock_get_hz(clk_peri));
+    ok &= f_write(&f, line, (UINT)n, &bw) == FR_OK && bw == (UINT)n;
+    ok &= f_close(&f) == FR_OK;
+    if (mounted) f_unmount("0:");
+    return ok;
+}
+
+uint32_t clock_tune_apply(void) {
+    uint8_t id[3] = {0};
+    read_jedec_id(id);
+    clock_tune_t t;
+    if (!clock_tune_load(id, &t)) return 0;
+    uint32_t hz = t.read_req_hz < t.prog_req_hz ? t.read_req_hz : t.prog_req_hz;
+    if (!hz) return 0;
+    return flash_set_clock(hz);
+}
@@ -3,6 +3,7 @@
 #include "pico/stdlib.h"
 #include "ff.h"
 #include "csvlog.h"
+#include "flash.h"      // cs column: which chip the row came from
 
 // Keep FatFs state here (single module owns these)
 static FATFS g_fs;              // filesystem
@@ -29,6 +30,47 @@ static FRESULT ensure_sd_dir(void){
 }
 
 
+// Open 'path' to append rows under 'hdr'. A file that starts with any
+// other header (an older column layout) is renamed to <name>_oldN.csv
+// first, so two layouts never share one file.
+static FRESULT open_csv_with_header(FIL *f, const char *path, const char *hdr) {
+    FRESULT fr = f_open(f, path, FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
+    if (fr != FR_OK) return fr;
+    UINT len = (UINT)strlen(hdr);
+
+    if (f_size(f) != 0) {
+        char cur[512];
+        UINT br = 0;
+        if (len <= sizeof cur && f_read(f, cur, len, &br) == FR_OK && br == len && !memcmp(cur, hdr, len)) {
+            f_lseek(f, f_size(f)); // append
+            return FR_OK;
+        }
+        f_close(f);
+
+        char old[64];
+        const char *dot = strrchr(path, '.');
+        int stem = dot ? (int)(dot - path) : (int)strlen(path);
+        fr = FR_EXIST;
+        for (int i = 1; i < 100 && fr == FR_EXIST; i++) {
+            snprintf(old, sizeof old, "%.*s_old%d.csv", stem, path, i);
+            fr = f_rename(path, old);
+        }
+        if (fr != FR_OK) {
+            printf("ERROR: %s has an older column layout and could not be moved aside (err=%d).\r\n", path, fr);
+            return fr;
+        }
+        printf("%s had an older column layout; moved it to %s.\r\n", path, old);
+        fr = f_open(f, path, FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
+        if (fr != FR_OK) return fr;
+    }
+
+    UINT bw = 0;
+    fr = f_write(f, hdr, len, &bw);
+    if (fr != FR_OK || bw != len) printf("ERROR: Failed writing %s header (err=%d).\r\n", path, fr);
+    f_sync(f);
+    return FR_OK;
+}
+
 // ---------------- results.csv (per-measurement rows) ----------------
 
 FRESULT csv_begin(void) {
@@ -37,21 +79,13 @@ FRESULT csv_begin(void) {
 
     f_mkdir("0:/pico_test"); // OK if exists
 
-    fr = f_open(&g_csv, CSV_PATH, FA_OPEN_ALWAYS | FA_WRITE);
+    fr = open_csv_with_header(&g_csv, CSV_PATH,
+                              "run,op,spi_hz,addr,bytes,duration_us,mbps,verify_errors,status1_end,cs,"
+                              "wren_cyc,cmd_cyc,data_cyc,wip_cyc,status_cyc\r\n");
     if (fr != FR_OK) {
         printf("ERROR: Could not open %s (err=%d).\r\n", CSV_PATH, fr);
         return fr;
     }
-
-    if (f_size(&g_csv) == 0) {
-        const char *hdr = "run,op,spi_hz,addr,bytes,duration_us,mbps,verify_errors,status1_end\r\n";
-        UINT bw=0; fr = f_write(&g_csv, hdr, (UINT)strlen(hdr), &bw);
-        if (fr != FR_OK || bw != (UINT)strlen(hdr)) {
-            printf("ERROR: Failed writing results header (err=%d).\r\n", fr);
-        }
-        f_sync(&g_csv);
-    }
-    f_lseek(&g_csv, f_size(&g_csv)); // append
     g_csv_open = true;
     return FR_OK;
 }
@@ -73,12 +107,19 @@ static void _csv_append_line(const char *line){
 
 void csv_row_to_sd(bool save, int run, const char* op, uint32_t hz,
                    uint32_t addr, uint32_t bytes, int64_t dur_us,
-                   double mbps, uint32_t verify_errors, uint8_t sr1_end)
+                   double mbps, uint32_t verify_errors, uint8_t sr1_end,
+                   const flash_phase_log_t *phases)
 {
     if (!save || !g_csv_open) return;
     char line[192];
-    int n = snprintf(line, sizeof line, "%d,%s,%u,0x%06X,%u,%lld,%.6f,%u,%02X\r\n",
-                     run, op, hz, addr, bytes, (long long)dur_us, mbps, verify_errors, sr1_end);
+    int n = snprintf(line, sizeof line, "%d,%s,%u,0x%06X,%u,%lld,%.6f,%u,%02X,%u",
+                     run, op, hz, addr, bytes, (long long)dur_us, mbps, verify_errors, sr1_end,
+                     flash_dev_cs_pin(NULL));
+    for (int ph = 0; ph < FLASH_PHASES && n > 0 && n < (int)sizeof line; ph++) {
+        if (phases) n += snprintf(line + n, sizeof line - n, ",%u", (unsigned)phases->cycles[ph]);
+        else        n += snprintf(line + n, sizeof line - n, ",");
+    }
+    if (n > 0 && n < (int)sizeof line) n += snprintf(line + n, sizeof line - n, "\r\n");
     if (n > 0 && n < (int)sizeof line) _csv_append_line(line);
 }
 
@@ -157,31 +198,22 @@ FRESULT bench_csv_begin(void) {
     FRESULT fr;
     f_mkdir("0:/pico_test"); // OK if exists
 
-    fr = f_open(&g_bench_csv, BENCH_PATH, FA_OPEN_ALWAYS | FA_WRITE);
+    const char *hdr =
+        "timestamp_ms,jedec_hex,spi_hz,avg_erase_ms,avg_write256_kBps,avg_readseq_kBps,avg_readrand_MBps,verify_errors,read_mode,avg_erase32_ms,avg_erase64_ms,cs,"
+        "erase_p50_ms,erase_p95_ms,erase_p99_ms,erase_max_ms,erase_sd_ms,"
+        "write_p50_us,write_p95_us,write_p99_us,write_max_us,write_sd_us,"
+        "readseq_p50_us,readseq_p95_us,readseq_p99_us,readseq_max_us,readseq_sd_us\r\n";
+    fr = open_csv_with_header(&g_bench_csv, BENCH_PATH, hdr);
     if (fr == FR_NOT_READY) {
         // Fallback: allow standalone use (no csv_begin() before)
         fr = f_mount(&g_fs, "0:", 1);
         if (fr != FR_OK) { _friendly_mount_error(fr); return fr; }
-        fr = f_open(&g_bench_csv, BENCH_PATH, FA_OPEN_ALWAYS | FA_WRITE);
+        fr = open_csv_with_header(&g_bench_csv, BENCH_PATH, hdr);
     }
     if (fr != FR_OK) {
         printf("ERROR: Could not open %s (err=%d).\r\n", BENCH_PATH, fr);
         return fr;
     }
-
-    if (f_size(&g_bench_csv) == 0) {
-        const char *hdr =
-            "timestamp_ms,jedec_hex,spi_hz,avg_erase_ms,avg_write256_kBps,avg_readseq_kBps,avg_readrand_MBps,verify_errors\r\n"
-;
-        UINT bw = 0;
-        fr = f_write(&g_bench_csv, hdr, (UINT)strlen(hdr), &bw);
-        if (fr != FR_OK || bw != (UINT)strlen(hdr)) {
-            printf("ERROR: Failed writing benchmark header (err=%d).\r\n", fr);
-        }
-        f_sync(&g_bench_csv);
-    }
-
-    f_lseek(&g_bench_csv, f_size(&g_bench_csv)); // append
     g_bench_open = true;
     return FR_OK;
 }
@@ -192,17 +224,36 @@ void bench_csv_append_avg(const char *jedec_hex,
                           double avg_write_kBps,
                           double avg_readseq_kBps,
                           double avg_readrand_MBps,
-                          uint32_t verify_errors)
+                          uint32_t verify_errors,
+                          const char *read_mode,
+                          double avg_erase32_ms,
+                          double avg_erase64_ms,
+                          const lat_stats_t *erase,
+                          const lat_stats_t *write,
+                          const lat_stats_t *readseq)
 
 {
     if (!g_bench_open) return;
-    char line[196];
+    char line[400];
     uint32_t t_ms = to_ms_since_boot(get_absolute_time());
     int n = snprintf(line, sizeof line,
-    "%u,%s,%u,%.3f,%.3f,%.3f,%.3f,%u\r\n",
+    "%u,%s,%u,%.3f,%.3f,%.3f,%.3f,%u,%s,%.3f,%.3f,%u",
     t_ms,
     (jedec_hex && *jedec_hex) ? jedec_hex : "000000",
-    hz, avg_erase_ms, avg_write_kBps, avg_readseq_kBps, avg_readrand_MBps, verify_errors);
+    hz, avg_erase_ms, avg_write_kBps, avg_readseq_kBps, avg_readrand_MBps, verify_errors,
+    (read_mode && *read_mode) ? read_mode : "1-1-1",
+    avg_erase32_ms, avg_erase64_ms, flash_dev_cs_pin(NULL));
+    // p50, p95, p99, max, stddev; erase in ms like avg_erase_ms, the rest in us
+    const lat_stats_t *lat[3] = { erase, write, readseq };
+    for (int k = 0; k < 3 && n > 0 && n < (int)sizeof line; k++) {
+        const lat_stats_t *s = lat[k] && lat[k]->n ? lat[k] : NULL;
+        double scale = k == 0 ? 1000.0 : 1.0;
+        if (s) n += snprintf(line + n, sizeof line - n, ",%.3f,%.3f,%.3f,%.3f,%.3f",
+                             lat_stats_quantile(s, 0) / scale, lat_stats_quantile(s, 1) / scale,
+                             lat_stats_quantile(s, 2) / scale, s->max / scale, lat_stats_stddev(s) / scale);
+        else   n += snprintf(line + n, sizeof line - n, ",,,,,");
+    }
+    if (n > 0 && n < (int)sizeof line) n += snprintf(line + n, sizeof line - n, "\r\n");
     if (n > 0 && n < (int)sizeof line) {
         UINT bw=0; FRESULT fr = f_write(&g_bench_csv, line, (UINT)n, &bw);
         if (fr != FR_OK || bw != (UINT)n) printf("ERROR: benchmark.csv append err=%d\r\n", fr);
@@ -0,0 +1,85 @@
+#include <math.h>
+#include "lat_stats.h"
+
+const double LAT_STATS_P[LAT_STATS_QUANTILES] = { 0.50, 0.95, 0.99 };
+
+// Linear interpolation between the sorted samples around rank p*(n-1)
+static double exact_quantile(const float *v, uint32_t n, double p) {
+    double r = p * (n - 1u);
+    uint32_t lo = (uint32_t)r;
+    if (lo + 1u >= n) return v[n - 1u];
+    return v[lo] + (r - lo) * (v[lo + 1u] - v[lo]);
+}
+
+// Markers at the ranks P² wants for n samples (kept distinct), heights
+// interpolated from the sort at the wanted ranks
+static void p2_seed(lat_p2_t *e, const float *v, uint32_t n, double p) {
+    const double frac[5] = { 0.0, p / 2.0, p, (1.0 + p) / 2.0, 1.0 };
+    for (int i = 0; i < 5; i++) {
+        e->want[i] = 1.0 + (n - 1u) * frac[i];
+        e->pos[i]  = (int32_t)lround(e->want[i]);
+        if (i && e->pos[i] <= e->pos[i - 1]) e->pos[i] = e->pos[i - 1] + 1;
+    }
+    for (int i = 4; i > 0 && e->pos[i] > (int32_t)n - (4 - i); i--)
+        e->pos[i] = (int32_t)n - (4 - i);          // keep them distinct at the top
+    for (int i = 0; i < 5; i++) e->q[i] = exact_quantile(v, n, frac[i]);
+}
+
+static void p2_add(lat_p2_t *e, double x, double p) {
+    // Cell the sample falls in; the end markers track min/max
+    int k;
+    if (x < e->q[0])       { e->q[0] = x; k = 0; }
+    else if (x >= e->q[4]) { e->q[4] = x; k = 3; }
+    else for (k = 0; k < 3 && x >= e->q[k + 1]; k++) { }
+
+    for (int i = k + 1; i < 5; i++) e->pos[i]++;
+    const double dwant[5] = { 0.0, p / 2.0, p, (1.0 + p) / 2.0, 1.0 };
+    for (int i = 0; i < 5; i++) e->want[i] += dwant[i];
+
+    // Nudge the middle markers towards where they should be
+    for (int i = 1; i < 4; i++) {
+        double d = e->want[i] - e->pos[i];
+        if ((d >= 1.0 && e->pos[i + 1] - e->pos[i] > 1) || (d <= -1.0 && e->pos[i - 1] - e->pos[i] < -1)) {
+            int s = d > 0 ? 1 : -1;
+            double span = e->pos[i + 1] - e->pos[i - 1];
+            double qp = e->q[i] + s / span *
+                ((e->pos[i] - e->pos[i - 1] + s) * (e->q[i + 1] - e->q[i]) / (e->pos[i + 1] - e->pos[i]) +
+                 (e->pos[i + 1] - e->pos[i] - s) * (e->q[i] - e->q[i - 1]) / (e->pos[i] - e->pos[i - 1]));
+            if (!(e->q[i - 1] < qp && qp < e->q[i + 1]))     // parabola overshot: go linear
+                qp = e->q[i] + s * (e->q[i + s] - e->q[i]) / (e->pos[i + s] - e->pos[i]);
+            e->q[i] = qp;
+            e->pos[i] += s;
+        }
+    }
+}
+
+void lat_stats_add(lat_stats_t *s, double x) {
+    s->n++;
+    if (s->n == 1u || x < s->min) s->min = x;
+    if (s->n == 1u || x > s->max) s->max = x;
+    double d = x - s->mean;
+    s->mean += d / s->n;
+    s->m2   += d * (x - s->mean);
+
+    if (s->n <= LAT_STATS_EXACT) {         // insertion sort into the exact window
+        uint32_t i = s->n - 1u;
+        while (i && s->first[i - 1u] > (float)x) { s->first[i] = s->first[i - 1u]; i--; }
+        s->first[i] = (float)x;
+        if (s->n == LAT_STATS_EXACT)
+            for (unsigned q = 0; q < LAT_STATS_QUANTILES; q++)
+                p2_seed(&s->p2[q], s->first, s->n, LAT_STATS_P[q]);
+        return;
+    }
+    for (unsigned q = 0; q < LAT_STATS_QUANTILES; q++)
+        p2_add(&s->p2[q], x, LAT_STATS_P[q]);
+}
+
+double lat_stats_stddev(const lat_stats_t *s) {
+    return s->n > 1u ? sqrt(s->m2 / (s->n - 1u)) : 0.0;
+}
+
+double lat_stats_quantile(const lat_stats_t *s, unsigned i) {
+    if (!s->n || i >= LAT_STATS_QUANTILES) return 0.0;
+    if (s->n <= LAT_STATS_EXACT) return exact_quantile(s->first, s->n, LAT_STATS_P[i]);
+    return s->p2[i].q[2];
+}
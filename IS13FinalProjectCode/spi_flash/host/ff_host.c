@@ -0,0 +1,175 @@
+// FatFs API on plain host files: "0:/pico_test/results.csv" lands in
+// <root>/pico_test/results.csv, so the CSVs the benchmarks write can be
+// diffed between runs.
+#include "ff.h"
+#include "hal_host.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FF_HOST_MAX_FILES 8
+
+static char s_root[256] = "sd";
+static struct { FIL *fp; FILE *f; } s_files[FF_HOST_MAX_FILES];
+
+void ff_host_set_root(const char *dir) { snprintf(s_root, sizeof s_root, "%s", dir); }
+const char *ff_host_root(void) { return s_root; }
+
+static void host_path(const TCHAR *path, char *out, size_t len) {
+    if (path[0] && path[1] == ':') path += 2;           // drive prefix
+    while (*path == '/') path++;
+    snprintf(out, len, "%s/%s", s_root, path);
+}
+
+static FILE *file_of(FIL *fp) {
+    for (int i = 0; i < FF_HOST_MAX_FILES; i++)
+        if (s_files[i].fp == fp && s_files[i].f) return s_files[i].f;
+    return NULL;
+}
+
+static void sync_pos(FIL *fp, FILE *f) {
+    long pos = ftell(f);
+    fp->fptr = pos < 0 ? 0 : (FSIZE_t)pos;
+    if (fp->fptr > fp->obj.objsize) fp->obj.objsize = fp->fptr;
+}
+
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt) {
+    (void)path; (void)opt;
+    if (!fs) return FR_OK;                               // f_unmount()
+    if (mkdir(s_root, 0777) != 0 && errno != EEXIST) return FR_NOT_READY;
+    return FR_OK;
+}
+
+FRESULT f_mkdir(const TCHAR *path) {
+    char p[512]; host_path(path, p, sizeof p);
+    if (mkdir(p, 0777) == 0) return FR_OK;
+    return errno == EEXIST ? FR_EXIST : FR_NO_PATH;
+}
+
+FRESULT f_stat(const TCHAR *path, FILINFO *fno) {
+    char p[512]; host_path(path, p, sizeof p);
+    struct stat st;
+    if (stat(p, &st) != 0) return FR_NO_FILE;
+    if (fno) {
+        memset(fno, 0, sizeof *fno);
+        fno->fsize   = (FSIZE_t)st.st_size;
+        fno->fattrib = S_ISDIR(st.st_mode) ? AM_DIR : 0;
+        const char *base = strrchr(p, '/');
+        snprintf(fno->fname, sizeof fno->fname, "%.*s", (int)(sizeof fno->fname - 1), base ? base + 1 : p);
+    }
+    return FR_OK;
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode) {
+    int slot = -1;
+    for (int i = 0; i < FF_HOST_MAX_FILES; i++) if (!s_files[i].f) { slot = i; break; }
+    if (slot < 0) return FR_TOO_MANY_OPEN_FILES;
+
+    char p[512]; host_path(path, p, sizeof p);
+    struct stat st;
+    bool exists = stat(p, &st) == 0;
+    FILE *f = NULL;
+
+    if ((mode & FA_CREATE_NEW) && exists) return FR_EXIST;
+    if (mode & (FA_CREATE_ALWAYS | FA_CREATE_NEW)) {
+        f = fopen(p, "w+b");
+    } else if (exists) {
+        f = fopen(p, (mode & FA_WRITE) ? "r+b" : "rb");
+    } else if (mode & FA_OPEN_ALWAYS) {
+        f = fopen(p, "w+b");
+    } else {
+        return FR_NO_FILE;
+    }
+    if (!f) return FR_DENIED;
+
+    memset(fp, 0, sizeof *fp);
+    fseek(f, 0, SEEK_END);
+    fp->obj.objsize = (FSIZE_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND) fseek(f, 0, SEEK_END);
+    fp->flag = mode;
+    s_files[slot].fp = fp;
+    s_files[slot].f  = f;
+    sync_pos(fp, f);
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp) {
+    for (int i = 0; i < FF_HOST_MAX_FILES; i++) {
+        if (s_files[i].fp == fp && s_files[i].f) {
+            fclose(s_files[i].f);
+            s_files[i].f = NULL; s_files[i].fp = NULL;
+            return FR_OK;
+        }
+    }
+    return FR_INVALID_OBJECT;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br) {
+    FILE *f = file_of(fp);
+    if (!f) return FR_INVALID_OBJECT;
+    *br = (UINT)fread(buff, 1, btr, f);
+    sync_pos(fp, f);
+    return ferror(f) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw) {
+    FILE *f = file_of(fp);
+    if (!f) return FR_INVALID_OBJECT;
+    fseek(f, 0, SEEK_CUR);                               // read -> write switch
+    *bw = (UINT)fwrite(buff, 1, btw, f);
+    sync_pos(fp, f);
+    return *bw == btw ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs) {
+    FILE *f = file_of(fp);
+    if (!f) return FR_INVALID_OBJECT;
+    if (fseek(f, (long)ofs, SEEK_SET) != 0) return FR_DISK_ERR;
+    sync_pos(fp, f);
+    return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp) {
+    FILE *f = file_of(fp);
+    if (!f) return FR_INVALID_OBJECT;
+    fflush(f);
+    if (ftruncate(fileno(f), (off_t)fp->fptr) != 0) return FR_DISK_ERR;
+    fp->obj.objsize = fp->fptr;
+    return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path) {
+    char p[512]; host_path(path, p, sizeof p);
+    return remove(p) == 0 ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_rename(const TCHAR *path_old, const TCHAR *path_new) {
+    char po[512], pn[512], *slash;
+    host_path(path_old, po, sizeof po);
+    // FatFs renames within the old name's volume: only the new name's path counts
+    if ((slash = strchr(path_new, ':')) != NULL) path_new = slash + 1;
+    host_path(path_new, pn, sizeof pn);
+    struct stat st;
+    if (stat(po, &st) != 0) return FR_NO_FILE;
+    if (stat(pn, &st) == 0) return FR_EXIST;
+    return rename(po, pn) == 0 ? FR_OK : FR_DENIED;
+}
+
+FRESULT f_sync(FIL *fp) {
+    FILE *f = file_of(fp);
+    if (!f) return FR_INVALID_OBJECT;
+    return fflush(f) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+TCHAR *f_gets(TCHAR *buff, int len, FIL *fp) {
+    FILE *f = file_of(fp);
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_CUR);                               // write -> read switch
+    TCHAR *s = fgets(buff, len, f);
+    sync_pos(fp, f);
+    return s;
+}
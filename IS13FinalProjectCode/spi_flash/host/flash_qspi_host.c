@@ -0,0 +1,13 @@
+// Host build: no PIO, so only the 1-1-1 hardware-SPI reads exist.
+// flash_set_read_mode() refuses the dual/quad modes.
+#include "flash_qspi.h"
+
+bool flash_qspi_init(void) { return false; }
+
+bool flash_qspi_prepare(flash_read_mode_t mode) {
+    return mode == FLASH_READ_1_1_1;
+}
+
+void flash_qspi_read(flash_read_mode_t mode, uint32_t addr, uint8_t *buf, uint32_t len) {
+    (void)mode; (void)addr; (void)buf; (void)len;
+}
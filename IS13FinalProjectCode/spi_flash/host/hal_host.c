@@ -0,0 +1,295 @@
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include "hal_host.h"
+#include "nor_model.h"
+#include <string.h>
+
+#define HAL_CLK_PERI_HZ   125000000u
+#define HAL_CALL_NS       20u      // one clock read / tight loop pass
+#define HAL_SPI_CALL_NS   400u     // spi_*_blocking() entry and FIFO drain
+#define HAL_MAX_GPIO      30u
+
+static uint64_t s_now_ns = 0;
+static bool     s_in_irq = false;
+
+spi_hw_t host_spi_hw[2];
+dma_hw_t host_dma_hw;
+
+static bool s_gpio_out[HAL_MAX_GPIO];
+
+typedef struct {
+    bool                claimed;
+    bool                busy;
+    bool                irq0, irq1;
+    dma_channel_config  cfg;
+    volatile void      *write_addr;
+    const volatile void *read_addr;
+    uint                count;
+    uint64_t            done_ns;
+} hal_dma_t;
+static hal_dma_t s_dma[NUM_DMA_CHANNELS];
+
+static bool s_sniff_on;
+static uint s_sniff_ch, s_sniff_mode;
+
+#define HAL_IRQ_HANDLERS 4
+static irq_handler_t s_irq_handlers[2][HAL_IRQ_HANDLERS];
+static bool          s_irq_enabled[2];
+
+// ---------------- clock ----------------
+
+static void deliver_dma_irqs(void) {
+    if (s_in_irq) return;
+    s_in_irq = true;
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        hal_dma_t *d = &s_dma[ch];
+        if (!d->busy || d->done_ns > s_now_ns) continue;
+        d->busy = false;
+        for (int line = 0; line < 2; line++) {
+            bool en = line ? d->irq1 : d->irq0;
+            if (!en || !s_irq_enabled[line]) continue;
+            volatile uint32_t *ints = line ? &host_dma_hw.ints1 : &host_dma_hw.ints0;
+            *ints = 1u << ch;
+            for (int h = 0; h < HAL_IRQ_HANDLERS; h++)
+                if (s_irq_handlers[line][h]) s_irq_handlers[line][h]();
+            *ints = 0;                  // handlers write 1 to clear; plain stores here
+        }
+    }
+    s_in_irq = false;
+}
+
+uint64_t hal_now_ns(void) { return s_now_ns; }
+
+void hal_advance_ns(uint64_t ns) {
+    s_now_ns += ns;
+    deliver_dma_irqs();
+}
+
+absolute_time_t get_absolute_time(void) {
+    hal_advance_ns(HAL_CALL_NS);
+    return s_now_ns / 1000u;
+}
+
+void tight_loop_contents(void) { hal_advance_ns(HAL_CALL_NS); }
+
+// Counts down at clk_sys from boot once enabled, reloading from rvr
+static systick_hw_t s_systick;
+
+systick_hw_t *hal_systick(void) {
+    if (s_systick.csr & 1u) {
+        uint64_t cyc = s_now_ns * (clock_get_hz(clk_sys) / 1000000u) / 1000u;
+        s_systick.cvr = s_systick.rvr - (uint32_t)(cyc % ((uint64_t)s_systick.rvr + 1u));
+    }
+    return &s_systick;
+}
+
+void sleep_us(uint64_t us)        { hal_advance_ns(us * 1000u); }
+void sleep_ms(uint32_t ms)        { hal_advance_ns(ms * 1000000ull); }
+void busy_wait_us(uint64_t us)    { hal_advance_ns(us * 1000u); }
+void busy_wait_us_32(uint32_t us) { hal_advance_ns(us * 1000ull); }
+void busy_wait_ms(uint32_t ms)    { hal_advance_ns(ms * 1000000ull); }
+
+// ---------------- GPIO ----------------
+
+void gpio_init(uint gpio) {
+    if (gpio < HAL_MAX_GPIO) s_gpio_out[gpio] = false;
+}
+void gpio_set_dir(uint gpio, bool out) { (void)gpio; (void)out; }
+void gpio_set_function(uint gpio, enum gpio_function fn) { (void)gpio; (void)fn; }
+
+void gpio_put(uint gpio, bool value) {
+    if (gpio >= HAL_MAX_GPIO) return;
+    if (s_gpio_out[gpio] != value) {
+        s_gpio_out[gpio] = value;
+        nor_cs(gpio, value, s_now_ns);
+    }
+    s_now_ns += HAL_CALL_NS;
+}
+
+bool gpio_get(uint gpio) { return gpio < HAL_MAX_GPIO && s_gpio_out[gpio]; }
+
+// ---------------- SPI ----------------
+
+// Same divider search as the SDK: even prescale 2..254, postdiv 1..256
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate) {
+    uint freq_in = HAL_CLK_PERI_HZ;
+    uint prescale, postdiv;
+    if (!baudrate) baudrate = 1;
+    for (prescale = 2; prescale <= 254; prescale += 2) {
+        if ((uint64_t)freq_in < (uint64_t)(prescale + 2) * 256u * baudrate) break;
+    }
+    if (prescale > 254) prescale = 254;
+    for (postdiv = 256; postdiv > 1; --postdiv) {
+        if (freq_in / (prescale * (postdiv - 1)) > baudrate) break;
+    }
+    spi_get_hw(spi)->baud = freq_in / (prescale * postdiv);
+    return spi_get_hw(spi)->baud;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate) { return spi_set_baudrate(spi, baudrate); }
+
+uint spi_get_baudrate(const spi_inst_t *spi) { return ((const spi_hw_t *)spi)->baud; }
+
+static uint64_t byte_ns(const spi_hw_t *hw) {
+    return hw->baud ? 8000000000ull / hw->baud : 8000u;
+}
+
+static uint8_t spi_byte(spi_hw_t *hw, uint8_t mosi) {
+    s_now_ns += byte_ns(hw);
+    return nor_xfer(mosi, s_now_ns, hw->baud);
+}
+
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    spi_hw_t *hw = spi_get_hw(spi);
+    s_now_ns += HAL_SPI_CALL_NS;
+    for (size_t i = 0; i < len; i++) dst[i] = spi_byte(hw, src[i]);
+    deliver_dma_irqs();
+    return (int)len;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    spi_hw_t *hw = spi_get_hw(spi);
+    s_now_ns += HAL_SPI_CALL_NS;
+    for (size_t i = 0; i < len; i++) (void)spi_byte(hw, src[i]);
+    deliver_dma_irqs();
+    return (int)len;
+}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx, uint8_t *dst, size_t len) {
+    spi_hw_t *hw = spi_get_hw(spi);
+    s_now_ns += HAL_SPI_CALL_NS;
+    for (size_t i = 0; i < len; i++) dst[i] = spi_byte(hw, repeated_tx);
+    deliver_dma_irqs();
+    return (int)len;
+}
+
+// ---------------- DMA ----------------
+
+int dma_claim_unused_channel(bool required) {
+    (void)required;
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!s_dma[ch].claimed) { s_dma[ch].claimed = true; return (int)ch; }
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    if (channel < NUM_DMA_CHANNELS) s_dma[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = { DMA_SIZE_32, true, false, false, DREQ_FORCE };
+    return c;
+}
+
+static spi_hw_t *spi_of(const volatile void *addr) {
+    for (int i = 0; i < 2; i++)
+        if (addr == &host_spi_hw[i].dr) return &host_spi_hw[i];
+    return NULL;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger) {
+    hal_dma_t *d = &s_dma[channel];
+    d->cfg        = *config;
+    d->write_addr = write_addr;
+    d->read_addr  = read_addr;
+    d->count      = transfer_count;
+    if (trigger) dma_start_channel_mask(1u << channel);
+}
+
+static const uint8_t *elem(const volatile void *base, bool inc, uint i, uint size) {
+    return (const uint8_t *)base + (inc ? (size_t)i * size : 0u);
+}
+
+static void sniff(const hal_dma_t *d, uint8_t byte) {
+    if (!s_sniff_on || !d->cfg.sniff || d != &s_dma[s_sniff_ch] || s_sniff_mode > 1) return;
+    uint32_t crc = host_dma_hw.sniff_data;
+    if (s_sniff_mode == 0) {
+        crc ^= (uint32_t)byte << 24;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80000000u) ? (crc << 1) ^ 0x04C11DB7u : (crc << 1);
+    } else {
+        crc ^= byte;
+        for (int b = 0; b < 8; b++) crc = (crc & 1u) ? (crc >> 1) ^ 0xEDB88320u : (crc >> 1);
+    }
+    host_dma_hw.sniff_data = crc;
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    // SPI pairs first: TX feeds the bus, RX (if started with it) collects MISO
+    for (uint tx = 0; tx < NUM_DMA_CHANNELS; tx++) {
+        if (!(chan_mask & (1u << tx))) continue;
+        spi_hw_t *hw = spi_of(s_dma[tx].write_addr);
+        if (!hw) continue;
+        hal_dma_t *t = &s_dma[tx], *r = NULL;
+        for (uint rx = 0; rx < NUM_DMA_CHANNELS; rx++) {
+            if ((chan_mask & (1u << rx)) && spi_of(s_dma[rx].read_addr) == hw) { r = &s_dma[rx]; break; }
+        }
+        uint64_t t0 = s_now_ns, per = byte_ns(hw);
+        for (uint i = 0; i < t->count; i++) {
+            uint8_t mosi = *elem(t->read_addr, t->cfg.read_inc, i, 1);
+            uint8_t miso = nor_xfer(mosi, t0 + (uint64_t)(i + 1) * per, hw->baud);
+            sniff(t, mosi);
+            if (r) { *(uint8_t *)elem(r->write_addr, r->cfg.write_inc, i, 1) = miso; sniff(r, miso); }
+        }
+        t->busy = true; t->done_ns = t0 + (uint64_t)t->count * per;
+        if (r) { r->busy = true; r->done_ns = t->done_ns; }
+    }
+    // anything else is a memory copy, one transfer per system clock
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        hal_dma_t *d = &s_dma[ch];
+        if (!(chan_mask & (1u << ch)) || spi_of(d->write_addr) || spi_of(d->read_addr)) continue;
+        uint size = 1u << d->cfg.size;
+        for (uint i = 0; i < d->count; i++) {
+            const uint8_t *src = elem(d->read_addr, d->cfg.read_inc, i, size);
+            memcpy((void *)elem(d->write_addr, d->cfg.write_inc, i, size), src, size);
+            for (uint b = 0; b < size; b++) sniff(d, src[b]);
+        }
+        d->busy = true;
+        d->done_ns = s_now_ns + (uint64_t)d->count * (1000000000ull / HAL_CLK_PERI_HZ);
+    }
+    deliver_dma_irqs();
+}
+
+bool dma_channel_is_busy(uint channel) {
+    hal_advance_ns(HAL_CALL_NS);
+    return s_dma[channel].busy;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+    hal_dma_t *d = &s_dma[channel];
+    if (d->busy && d->done_ns > s_now_ns) s_now_ns = d->done_ns;
+    deliver_dma_irqs();
+    d->busy = false;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) { s_dma[channel].irq0 = enabled; }
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) { s_dma[channel].irq1 = enabled; }
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable) {
+    s_sniff_on = true; s_sniff_ch = channel; s_sniff_mode = mode;
+    if (force_channel_enable) s_dma[channel].cfg.sniff = true;
+}
+
+void dma_sniffer_disable(void) { s_sniff_on = false; }
+
+// ---------------- IRQ ----------------
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    if (num != DMA_IRQ_0 && num != DMA_IRQ_1) return;
+    irq_handler_t *slots = s_irq_handlers[num - DMA_IRQ_0];
+    for (int h = 0; h < HAL_IRQ_HANDLERS; h++) {
+        if (!slots[h]) { slots[h] = handler; return; }
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num == DMA_IRQ_0 || num == DMA_IRQ_1) s_irq_enabled[num - DMA_IRQ_0] = enabled;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+// Host-side controls that have no SDK counterpart.
+uint64_t hal_now_ns(void);              // simulated time since start
+void     hal_advance_ns(uint64_t ns);   // spend simulated time, deliver due DMA IRQs
+
+// FatFs volume "0:" maps onto this directory (default "sd").
+void ff_host_set_root(const char *dir);
+const char *ff_host_root(void);
@@ -0,0 +1,7 @@
+#pragma once
+#include "pico/types.h"
+
+enum clock_index { clk_sys = 5, clk_peri = 6 };
+
+// Both fixed at 125 MHz in the model
+static inline uint32_t clock_get_hz(enum clock_index clk) { (void)clk; return 125000000u; }
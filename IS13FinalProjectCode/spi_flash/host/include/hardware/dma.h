@@ -0,0 +1,52 @@
+#pragma once
+#include "pico/types.h"
+
+#define NUM_DMA_CHANNELS 12
+#define DREQ_FORCE       0x3F
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    uint8_t size;                      // dma_channel_transfer_size
+    bool    read_inc, write_inc;
+    bool    sniff;
+    uint    dreq;
+} dma_channel_config;
+
+typedef struct {
+    volatile uint32_t ints0, ints1;
+    volatile uint32_t sniff_data;
+} dma_hw_t;
+extern dma_hw_t host_dma_hw;
+#define dma_hw (&host_dma_hw)
+
+int  dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size size) {
+    c->size = (uint8_t)size;
+}
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_inc = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_inc = incr; }
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+static inline void channel_config_set_sniff_enable(dma_channel_config *c, bool en) { c->sniff = en; }
+
+// A TX/RX pair aimed at an SPI DR runs through the bus in one go when
+// started; completion (and DMA_IRQ_x) lands once the simulated clock has
+// passed the bytes' wire time. Memory-to-memory copies finish at once.
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger);
+void dma_start_channel_mask(uint32_t chan_mask);
+static inline void dma_channel_start(uint channel) { dma_start_channel_mask(1u << channel); }
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+
+// Sniffer: modes 0 (CRC-32, MSB first) and 1 (CRC-32, bit-reversed data)
+// over the bytes the chosen channel moves; other modes leave sniff_data be.
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable);
+void dma_sniffer_disable(void);
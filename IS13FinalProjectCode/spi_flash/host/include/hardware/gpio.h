@@ -0,0 +1,21 @@
+#pragma once
+#include "pico/types.h"
+
+#define GPIO_OUT  1
+#define GPIO_IN   0
+
+enum gpio_function {
+    GPIO_FUNC_SPI  = 1,
+    GPIO_FUNC_SIO  = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+// Output levels are tracked; a pin with a NOR model attached is its CS.
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+static inline void gpio_pull_up(uint gpio) { (void)gpio; }
@@ -0,0 +1,37 @@
+#pragma once
+#include "pico/types.h"
+
+typedef struct {
+    volatile uint32_t dr;              // DMA targets this to pick the bus
+    uint32_t          baud;
+} spi_hw_t;
+typedef struct spi_inst spi_inst_t;
+
+extern spi_hw_t host_spi_hw[2];
+#define spi0 ((spi_inst_t *)&host_spi_hw[0])
+#define spi1 ((spi_inst_t *)&host_spi_hw[1])
+
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return (spi_hw_t *)spi; }
+static inline uint spi_get_index(const spi_inst_t *spi) {
+    return (const spi_hw_t *)spi == &host_spi_hw[1];
+}
+static inline uint spi_get_dreq(spi_inst_t *spi, bool is_tx) {
+    return 16u + 2u * spi_get_index(spi) + (is_tx ? 0u : 1u);
+}
+
+// Bytes go to whichever NOR model has its CS low (0xFF if none) and cost
+// 8 SCK periods of simulated time at the configured baud.
+uint spi_init(spi_inst_t *spi, uint baudrate);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+uint spi_get_baudrate(const spi_inst_t *spi);
+static inline void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol,
+                                  spi_cpha_t cpha, spi_order_t order) {
+    (void)spi; (void)data_bits; (void)cpol; (void)cpha; (void)order;
+}
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx, uint8_t *dst, size_t len);
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
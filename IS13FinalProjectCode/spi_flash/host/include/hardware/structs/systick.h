@@ -0,0 +1,14 @@
+#pragma once
+#include "pico/types.h"
+
+// Cortex-M0+ SysTick. Reading through systick_hw brings cvr up to the
+// simulated clock (hal_host.c); a write to cvr is not modelled.
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    volatile uint32_t cvr;
+    volatile uint32_t calib;
+} systick_hw_t;
+
+systick_hw_t *hal_systick(void);
+#define systick_hw (hal_systick())
@@ -0,0 +1,19 @@
+#pragma once
+// Host build: the slice of the Pico SDK used by flash.c, sfdp.c, bench.c,
+// csvlog.c and analyze.c, implemented in hal_host.c on top of the NOR
+// model and a simulated clock. Not a general SDK replacement.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "pico/types.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#define __not_in_flash_func(f)   f
+#define __time_critical_func(f)  f
+
+// Costs a little simulated time and delivers due DMA interrupts.
+void tight_loop_contents(void);
+
+static inline bool stdio_init_all(void) { return true; }
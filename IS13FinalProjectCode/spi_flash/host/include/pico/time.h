@@ -0,0 +1,25 @@
+#pragma once
+#include "pico/types.h"
+
+// Simulated clock (hal_host.c). It only moves when the firmware spends
+// time: SPI bytes on the wire, sleeps, busy-waits and a small cost per
+// clock read, so polling loops still make progress.
+absolute_time_t get_absolute_time(void);
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000u); }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + 1000ull * ms; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return get_absolute_time() + us; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return get_absolute_time() + 1000ull * ms; }
+static inline bool time_reached(absolute_time_t t) { return get_absolute_time() >= t; }
+static inline uint64_t time_us_64(void) { return get_absolute_time(); }
+static inline uint32_t time_us_32(void) { return (uint32_t)get_absolute_time(); }
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+void busy_wait_us_32(uint32_t us);
+void busy_wait_ms(uint32_t ms);
@@ -0,0 +1,361 @@
+#include "nor_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define NOR_MAX_CHIPS      4
+#define SR1_WIP            0x01u
+#define SR1_WEL            0x02u
+#define SR2_SUS            0x80u
+#define NOR_SUSPEND_US     20u      // suspend latency before WIP drops
+#define NOR_WRSR_US        2000u    // status register write
+#define NOR_RESET_US       30u      // tRST after 0x66/0x99
+
+typedef enum {
+    BUSY_NONE = 0,
+    BUSY_PROG,
+    BUSY_ERASE,
+    BUSY_WRSR,
+    BUSY_SUSPEND,                   // suspend latency; WEL untouched
+    BUSY_RESET
+} busy_kind_t;
+
+typedef struct {
+    bool          used;
+    uint          cs_pin;
+    nor_profile_t p;
+    uint8_t      *mem;
+    uint8_t      *page;             // program latch, one page
+
+    uint8_t       sr1, sr2;         // non-volatile bits only; WIP/WEL/SUS come from state
+    bool          wel;
+    bool          four_byte;
+    bool          reset_armed;      // 0x66 seen, 0x99 next
+    busy_kind_t   busy;
+    uint64_t      busy_until_ns;
+    bool          suspended;
+    busy_kind_t   sus_kind;
+    uint64_t      sus_left_ns;
+
+    // current transaction
+    bool          selected;
+    bool          ignore;           // command arrived while busy
+    uint8_t       cmd;
+    uint32_t      n;                // bytes so far, opcode included
+    uint8_t       addr_len;
+    uint8_t       dummy;
+    uint32_t      addr;
+    uint32_t      data_n;           // data bytes after address/dummy
+    uint8_t       wr[2];            // WRSR payload
+} nor_chip_t;
+
+static nor_chip_t s_chips[NOR_MAX_CHIPS];
+
+// ---------------- profiles ----------------
+
+void nor_profile_default(nor_profile_t *p) {
+    memset(p, 0, sizeof *p);
+    snprintf(p->model, sizeof p->model, "W25Q64-like");
+    p->jedec[0] = 0xEF; p->jedec[1] = 0x40; p->jedec[2] = 0x17;
+    p->size_bytes    = 8u * 1024u * 1024u;
+    p->page_size     = 256u;
+    p->t_prog_us     = 700u;
+    p->t_erase4k_us  = 45000u;
+    p->t_erase32k_us = 120000u;
+    p->t_erase64k_us = 150000u;
+    p->t_chip_us     = 20u * 1000u * 1000u;
+    p->max_read_hz   = 104u * 1000u * 1000u;
+}
+
+// "9D:4013", "EF 40 16", "1F:17" (capacity byte only)
+static bool parse_jedec(const char *s, uint8_t id[3]) {
+    unsigned a = 0, b = 0, c = 0;
+    if (sscanf(s, "%x %x %x", &a, &b, &c) == 3) {
+        id[0] = (uint8_t)a; id[1] = (uint8_t)b; id[2] = (uint8_t)c;
+        return true;
+    }
+    if (sscanf(s, "%x:%x", &a, &b) == 2) {
+        id[0] = (uint8_t)a;
+        id[1] = (uint8_t)(b > 0xFFu ? b >> 8 : 0x00u);
+        id[2] = (uint8_t)b;
+        return true;
+    }
+    return false;
+}
+
+static uint32_t ms_to_us(const char *s) { return (uint32_t)(strtod(s, NULL) * 1000.0 + 0.5); }
+
+bool nor_profile_from_csv(const char *path, const char *key, nor_profile_t *p) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[512];
+    bool found = false;
+    if (!fgets(line, sizeof line, f)) { fclose(f); return false; }   // header
+    while (!found && fgets(line, sizeof line, f)) {
+        // same cleanup as analyze.c: drop every quote, then split on commas
+        char *w = line;
+        for (char *r = line; *r; r++) if (*r != '"') *w++ = *r;
+        *w = '\0';
+
+        char *col[17] = {0};
+        int n = 0;
+        for (char *tok = line; tok && n < 17; n++) {
+            col[n] = tok;
+            tok = strchr(tok, ',');
+            if (tok) *tok++ = '\0';
+        }
+        if (n < 14) continue;
+
+        nor_profile_t r;
+        nor_profile_default(&r);
+        snprintf(r.model, sizeof r.model, "%s", col[0]);
+        if (!parse_jedec(col[4], r.jedec)) continue;
+
+        char hex[7];
+        snprintf(hex, sizeof hex, "%02X%02X%02X", r.jedec[0], r.jedec[1], r.jedec[2]);
+        if (key && strcasecmp(key, r.model) != 0 && strcasecmp(key, hex) != 0) continue;
+
+        r.size_bytes    = (uint32_t)strtoul(col[3], NULL, 10) * 1024u * 1024u / 8u;
+        r.t_erase4k_us  = ms_to_us(col[5]);
+        r.t_erase32k_us = ms_to_us(col[7]);
+        r.t_erase64k_us = ms_to_us(col[9]);
+        r.max_read_hz   = (uint32_t)strtoul(col[11], NULL, 10) * 1000u * 1000u;
+        r.t_prog_us     = ms_to_us(col[12]);
+        // no chip erase column: a 64K block's worth per block
+        r.t_chip_us     = r.size_bytes ? r.t_erase64k_us * (r.size_bytes / 65536u) : 0u;
+        if (!r.size_bytes || !r.t_prog_us || !r.t_erase4k_us) continue;
+        *p = r;
+        found = true;
+    }
+    fclose(f);
+    return found;
+}
+
+// ---------------- model ----------------
+
+bool nor_attach(uint cs_pin, const nor_profile_t *p) {
+    for (int i = 0; i < NOR_MAX_CHIPS; i++) {
+        nor_chip_t *c = &s_chips[i];
+        if (c->used) continue;
+        memset(c, 0, sizeof *c);
+        c->mem  = malloc(p->size_bytes);
+        c->page = malloc(p->page_size);
+        if (!c->mem || !c->page) { free(c->mem); free(c->page); return false; }
+        memset(c->mem, 0xFF, p->size_bytes);
+        c->used   = true;
+        c->cs_pin = cs_pin;
+        c->p      = *p;
+        return true;
+    }
+    return false;
+}
+
+void nor_detach_all(void) {
+    for (int i = 0; i < NOR_MAX_CHIPS; i++) {
+        free(s_chips[i].mem);
+        free(s_chips[i].page);
+        memset(&s_chips[i], 0, sizeof s_chips[i]);
+    }
+}
+
+const uint8_t *nor_mem(uint cs_pin, uint32_t *size) {
+    for (int i = 0; i < NOR_MAX_CHIPS; i++) {
+        if (s_chips[i].used && s_chips[i].cs_pin == cs_pin) {
+            if (size) *size = s_chips[i].p.size_bytes;
+            return s_chips[i].mem;
+        }
+    }
+    return NULL;
+}
+
+// Retire a finished busy period. Program/erase/WRSR completion clears WEL.
+static bool is_busy(nor_chip_t *c, uint64_t now) {
+    if (c->busy != BUSY_NONE && now >= c->busy_until_ns) {
+        if (c->busy == BUSY_PROG || c->busy == BUSY_ERASE || c->busy == BUSY_WRSR) c->wel = false;
+        c->busy = BUSY_NONE;
+    }
+    return c->busy != BUSY_NONE;
+}
+
+static void start_busy(nor_chip_t *c, busy_kind_t kind, uint32_t us, uint64_t now) {
+    c->busy = kind;
+    c->busy_until_ns = now + 1000ull * us;
+}
+
+static bool is_status_cmd(uint8_t op) { return op == 0x05 || op == 0x35; }
+static bool is_suspend_cmd(uint8_t op) { return op == 0x75 || op == 0xB0; }
+static bool is_resume_cmd(uint8_t op) { return op == 0x7A || op == 0x30; }
+
+static uint32_t erase_size(const nor_chip_t *c, uint8_t op) {
+    switch (op) {
+    case 0x20: case 0x21: return 4096u;
+    case 0x52: case 0x5C: return 32u * 1024u;
+    case 0xD8: case 0xDC: return 64u * 1024u;
+    case 0xC7: case 0x60: return c->p.size_bytes;
+    default:              return 0;
+    }
+}
+
+// Address width and dummy bytes for commands that carry an address
+static bool addr_phase(const nor_chip_t *c, uint8_t op, uint8_t *alen, uint8_t *dummy) {
+    uint8_t mode = c->four_byte ? 4 : 3;
+    *dummy = 0;
+    switch (op) {
+    case 0x03: *alen = mode; return true;
+    case 0x0B: *alen = mode; *dummy = 1; return true;
+    case 0x13: *alen = 4; return true;
+    case 0x0C: *alen = 4; *dummy = 1; return true;
+    case 0x5A: *alen = 3; *dummy = 1; return true;
+    case 0x02: case 0x20: case 0x52: case 0xD8: *alen = mode; return true;
+    case 0x12: case 0x21: case 0x5C: case 0xDC: *alen = 4; return true;
+    default: return false;
+    }
+}
+
+static void begin_cmd(nor_chip_t *c, uint8_t op, uint64_t now) {
+    c->cmd = op;
+    bool busy = is_busy(c, now);
+    // while busy only status reads and suspend get through; while
+    // suspended nothing new may program or erase
+    c->ignore = busy && !is_status_cmd(op) && !is_suspend_cmd(op);
+    if (c->suspended && (op == 0x02 || op == 0x12 || erase_size(c, op))) c->ignore = true;
+    if (op != 0x66 && op != 0x99) c->reset_armed = false;
+    c->addr_len = 0;
+    c->dummy = 0;
+    if (!addr_phase(c, op, &c->addr_len, &c->dummy)) c->addr_len = 0;
+    if (op == 0x02 || op == 0x12) memset(c->page, 0xFF, c->p.page_size);
+}
+
+static uint8_t read_byte(nor_chip_t *c, uint32_t hz) {
+    uint32_t a = c->addr % c->p.size_bytes;
+    uint8_t v = c->mem[a];
+    // past the part's read clock, roughly one byte in sixteen loses bit 0
+    if (c->p.max_read_hz && hz > c->p.max_read_hz && ((a * 2654435761u) >> 28) == 0) v ^= 0x01u;
+    c->addr++;
+    return v;
+}
+
+static uint8_t chip_xfer(nor_chip_t *c, uint8_t mosi, uint64_t now, uint32_t hz) {
+    uint32_t i = c->n++;
+    if (i == 0) { begin_cmd(c, mosi, now); return 0xFF; }
+    if (c->ignore) return 0xFF;
+
+    uint8_t op = c->cmd;
+    if (c->addr_len && i <= c->addr_len) {
+        c->addr = (c->addr << 8) | mosi;
+        return 0xFF;
+    }
+    if (c->addr_len && i <= (uint32_t)c->addr_len + c->dummy) return 0xFF;
+
+    switch (op) {
+    case 0x9F:
+        return i <= 3 ? c->p.jedec[i - 1] : 0x00;
+    case 0x05:
+        return (uint8_t)(c->sr1 | (is_busy(c, now) ? SR1_WIP : 0) | (c->wel ? SR1_WEL : 0));
+    case 0x35:
+        is_busy(c, now);
+        return (uint8_t)(c->sr2 | (c->suspended ? SR2_SUS : 0));
+    case 0x03: case 0x0B: case 0x13: case 0x0C:
+        return read_byte(c, hz);
+    case 0x5A:
+        return 0xFF;                               // no SFDP tables
+    case 0x02: case 0x12: {
+        uint32_t off = (c->addr + c->data_n) % c->p.page_size;   // wraps inside the page
+        c->page[off] = mosi;
+        c->data_n++;
+        return 0xFF;
+    }
+    case 0x01:
+        if (i <= 2) c->wr[i - 1] = mosi;
+        c->data_n = i;
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+// Commands take effect when CS goes high, as on the real parts.
+static void end_cmd(nor_chip_t *c, uint64_t now) {
+    if (c->n == 0 || c->ignore) return;
+    uint8_t op = c->cmd;
+    bool full_addr = c->addr_len && c->n == 1u + c->addr_len;
+
+    switch (op) {
+    case 0x06: case 0x50: c->wel = true; break;    // WREN, SST EWSR
+    case 0x04: c->wel = false; break;
+    case 0xB7: c->four_byte = true; break;
+    case 0xE9: c->four_byte = false; break;
+    case 0x66: c->reset_armed = true; break;
+    case 0x99:
+        if (!c->reset_armed) break;
+        c->reset_armed = false;
+        c->wel = false; c->four_byte = false;
+        c->suspended = false;
+        start_busy(c, BUSY_RESET, NOR_RESET_US, now);
+        break;
+    case 0x01:
+        if (!c->wel || c->data_n == 0) break;
+        c->sr1 = c->wr[0] & 0xFCu;
+        if (c->data_n >= 2) c->sr2 = c->wr[1] & 0x7Fu;
+        start_busy(c, BUSY_WRSR, NOR_WRSR_US, now);
+        break;
+    case 0x02: case 0x12: {
+        if (!c->wel || c->n <= 1u + c->addr_len) break;
+        uint32_t base = (c->addr % c->p.size_bytes) & ~(c->p.page_size - 1u);
+        for (uint32_t k = 0; k < c->p.page_size; k++) c->mem[base + k] &= c->page[k];
+        start_busy(c, BUSY_PROG, c->p.t_prog_us, now);
+        break;
+    }
+    default: {
+        uint32_t sz = erase_size(c, op);
+        if (!sz || !c->wel) break;
+        bool chip = sz == c->p.size_bytes && (op == 0xC7 || op == 0x60);
+        if (!chip && !full_addr) break;
+        uint32_t base = chip ? 0 : (c->addr % c->p.size_bytes) & ~(sz - 1u);
+        memset(c->mem + base, 0xFF, sz);
+        uint32_t us = sz == 4096u ? c->p.t_erase4k_us
+                    : sz == 32u * 1024u ? c->p.t_erase32k_us
+                    : sz == 64u * 1024u ? c->p.t_erase64k_us
+                    : c->p.t_chip_us;
+        start_busy(c, BUSY_ERASE, us, now);
+        break;
+    }
+    }
+
+    if (is_suspend_cmd(op) && is_busy(c, now) && !c->suspended &&
+        (c->busy == BUSY_PROG || c->busy == BUSY_ERASE)) {
+        c->sus_kind    = c->busy;
+        c->sus_left_ns = c->busy_until_ns - now;
+        c->suspended   = true;
+        start_busy(c, BUSY_SUSPEND, NOR_SUSPEND_US, now);
+    } else if (is_resume_cmd(op) && c->suspended && !is_busy(c, now)) {
+        c->suspended     = false;
+        c->busy          = c->sus_kind;
+        c->busy_until_ns = now + c->sus_left_ns;
+    }
+}
+
+void nor_cs(uint pin, bool level, uint64_t now_ns) {
+    for (int i = 0; i < NOR_MAX_CHIPS; i++) {
+        nor_chip_t *c = &s_chips[i];
+        if (!c->used || c->cs_pin != pin) continue;
+        if (!level && !c->selected) {
+            c->selected = true;
+            c->n = 0; c->data_n = 0; c->addr = 0; c->ignore = false;
+        } else if (level && c->selected) {
+            end_cmd(c, now_ns);
+            c->selected = false;
+        }
+    }
+}
+
+uint8_t nor_xfer(uint8_t mosi, uint64_t now_ns, uint32_t hz) {
+    uint8_t miso = 0xFF;                           // pulled up when nobody drives it
+    for (int i = 0; i < NOR_MAX_CHIPS; i++) {
+        nor_chip_t *c = &s_chips[i];
+        if (c->used && c->selected) miso &= chip_xfer(c, mosi, now_ns, hz);
+    }
+    return miso;
+}
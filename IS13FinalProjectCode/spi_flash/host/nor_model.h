@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+// ---- Part profile ----
+// Busy times are the datasheet typicals from spichips.csv; the model
+// always takes exactly that long, so runs are repeatable.
+typedef struct {
+    char     model[32];
+    uint8_t  jedec[3];
+    uint32_t size_bytes;
+    uint32_t page_size;
+    uint32_t t_prog_us;
+    uint32_t t_erase4k_us;
+    uint32_t t_erase32k_us;
+    uint32_t t_erase64k_us;
+    uint32_t t_chip_us;
+    uint32_t max_read_hz;        // reads above this come back corrupted (0 = no limit)
+} nor_profile_t;
+
+// 8 MB, Winbond-ish ID and timings; what you get without spichips.csv.
+void nor_profile_default(nor_profile_t *p);
+// Row whose chip_model or JEDEC (hex, e.g. "EF4016") matches 'key', or
+// the first row if key is NULL. False if the file or row isn't there.
+bool nor_profile_from_csv(const char *path, const char *key, nor_profile_t *p);
+
+// ---- Model ----
+// One chip per CS pin. Honours WREN/WEL, WIP for the profile's busy
+// times (commands other than status reads and suspend are ignored while
+// busy), 1->0 programming with page wrap, erase to 0xFF, EN4B/EX4B and
+// the 4-byte opcodes, and erase/program suspend (SUS in SR2 bit 7).
+// No SFDP: 0x5A reads back 0xFF.
+bool nor_attach(uint cs_pin, const nor_profile_t *p);
+void nor_detach_all(void);
+
+// Bus side, driven by hal_host.c
+void    nor_cs(uint pin, bool level, uint64_t now_ns);
+uint8_t nor_xfer(uint8_t mosi, uint64_t now_ns, uint32_t hz);
+
+// Raw array access for checks from the host side
+const uint8_t *nor_mem(uint cs_pin, uint32_t *size);
@@ -0,0 +1,111 @@
+// Off-target run of the benchmark engine: flash.c, bench.c, csvlog.c and
+// analyze.c drive the NOR model through hal_host.c, and the CSVs land in
+// a directory standing in for the SD card.
+//
+//   flash_sim [-c spichips.csv] [-p part]... [-s sd_dir] [-t trials] [-r] [-i]
+//
+// Each -p (chip_model or JEDEC hex, e.g. IS25LP064A or 9D4013) fits one
+// part to the next FLASH_CS_PINS socket; without -p the first CSV row is
+// used. -r also writes per-run rows, -i runs the 12 MHz chip identification.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "flash.h"
+#include "bench.h"
+#include "csvlog.h"
+#include "analyze.h"
+#include "config.h"
+#include "nor_model.h"
+#include "hal_host.h"
+
+#ifndef FLASH_SIM_CHIPS_CSV
+#define FLASH_SIM_CHIPS_CSV "spichips.csv"
+#endif
+
+// analyze.c reads the reference table from the card
+static bool stage_chips_csv(const char *src) {
+    char dir[300], dst[320];
+    snprintf(dir, sizeof dir, "%s/pico_test", ff_host_root());
+    mkdir(ff_host_root(), 0777);
+    mkdir(dir, 0777);
+    snprintf(dst, sizeof dst, "%s/spichips.csv", dir);
+
+    FILE *in = fopen(src, "rb");
+    if (!in) return false;
+    FILE *out = fopen(dst, "wb");
+    if (!out) { fclose(in); return false; }
+    char buf[4096]; size_t n;
+    while ((n = fread(buf, 1, sizeof buf, in)) > 0) fwrite(buf, 1, n, out);
+    fclose(in); fclose(out);
+    return true;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-c spichips.csv] [-p part]... [-s sd_dir] [-t trials] [-r] [-i]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    static const uint cs_pins[] = FLASH_CS_PINS;
+    const size_t n_sockets = sizeof cs_pins / sizeof cs_pins[0];
+    const char *csv = FLASH_SIM_CHIPS_CSV;
+    const char *parts[sizeof cs_pins / sizeof cs_pins[0]] = {0};
+    size_t n_parts = 0;
+    int trials = 3;
+    bool per_run = false, identify = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:p:s:t:rih")) != -1) {
+        switch (opt) {
+        case 'c': csv = optarg; break;
+        case 'p':
+            if (n_parts == n_sockets) { fprintf(stderr, "only %zu sockets\n", n_sockets); return 2; }
+            parts[n_parts++] = optarg;
+            break;
+        case 's': ff_host_set_root(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 'r': per_run = true; break;
+        case 'i': identify = true; break;
+        default:  usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (trials < 1) trials = 1;
+
+    bool have_csv = stage_chips_csv(csv);
+    if (!have_csv) printf("NOTE: %s not found; no timing reference on the card\n", csv);
+
+    for (size_t i = 0; i < (n_parts ? n_parts : 1); i++) {
+        nor_profile_t p;
+        if (!nor_profile_from_csv(csv, parts[i], &p)) {
+            if (parts[i]) { fprintf(stderr, "part '%s' not in %s\n", parts[i], csv); return 2; }
+            nor_profile_default(&p);
+        }
+        if (!nor_attach(cs_pins[i], &p)) { fprintf(stderr, "out of memory for %s\n", p.model); return 1; }
+        printf("Socket CS=GP%u: %s  JEDEC %02X %02X %02X  %u KB  prog %u us  erase4K %u us\n",
+               cs_pins[i], p.model, p.jedec[0], p.jedec[1], p.jedec[2],
+               (unsigned)(p.size_bytes / 1024u), (unsigned)p.t_prog_us, (unsigned)p.t_erase4k_us);
+    }
+
+    // same bring-up as main() on the board
+    flash_init_spi(SPI_FREQ_HZ);
+    for (unsigned i = 0; i < flash_dev_count(); i++) {
+        flash_dev_select(flash_dev_get(i));
+        if (!flash_probe()) continue;
+        if (have_csv) chip_ref_seed_timing();
+    }
+    flash_dev_select(flash_dev_get(0));
+
+    FRESULT fr = csv_begin();
+    if (fr != FR_OK) { fprintf(stderr, "cannot open results under %s\n", ff_host_root()); return 1; }
+    csv_mark_session_start();
+    run_benchmarks_all_devices(trials, per_run, true);
+    csv_end();
+
+    if (identify && have_csv) identify_chip_from_bench_12mhz();
+
+    printf("\nSimulated time: %.3f s  (CSV under %s/pico_test)\n",
+           (double)hal_now_ns() / 1e9, ff_host_root());
+    nor_detach_all();
+    return 0;
+}
@@ -7,4 +7,9 @@
 typedef void (*printf_func_t)(const char *fmt, ...);
 
 void identify_chip_from_bench_12mhz(void);
-void identify_chip_from_bench_12mhz_with_output(printf_func_t out);
\ No newline at end of file
+void identify_chip_from_bench_12mhz_with_output(printf_func_t out);
+
+// Look the live JEDEC ID up in spichips.csv and hand the typ/max erase and
+// program times to the flash WIP poller. Mounts/unmounts the card itself,
+// so call it while nothing else has files open. False if no row matched.
+bool chip_ref_seed_timing(void);
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include "flash.h"      // flash_dev_t
+#include "bench_plan.h"
 
 // ========== Function Pointer Type ==========
 typedef void (*printf_func_t)(const char *format, ...);
@@ -10,6 +12,9 @@ typedef void (*printf_func_t)(const char *format, ...);
 // Convenience wrappers (use your default trials, e.g., 10 and 100)
 void run_benchmarks(bool save_per_run);
 void run_benchmarks_100(bool save_per_run);
+// Read throughput vs transfer size (16B-64KB, one CS each) over the whole
+// chip, per clock; save_per_run logs one results.csv row per size.
+void run_read_curve(bool save_per_run);
 
 // One-shot smoke test: erase → program → read-back + print
 void action_test_connection(void);
@@ -25,7 +30,8 @@ void init_benchmark_core(void);
 
 /**
  * @brief Start a fast benchmark on Core 1 (non-blocking)
- * @return true if benchmark started, false if already running
+ * @return true if benchmark started, false if already running or another
+ *         action owns the flash bus (see flash_bus_acquire())
  * 
  * This runs a reduced benchmark (2 frequencies × 2 trials = ~600ms)
  * on Core 1, leaving Core 0 free to handle web server requests.
@@ -75,9 +81,51 @@ void get_benchmark_results(char *out, size_t len);
  */
 void reset_benchmark(void);
 
+// ========== Flash Bus Owner ==========
+// SPI0 and the SD card belong to one of these at a time. Web actions run
+// from the lwIP IRQ on core 0 and can land in the middle of a serial menu
+// action, so every serial and web flash action claims the bus first and
+// the core-1 run holds it until it completes.
+typedef enum {
+    FLASH_BUS_FREE = 0,
+    FLASH_BUS_SERIAL,       // serial menu action
+    FLASH_BUS_WEB,          // web action (lwIP callback)
+    FLASH_BUS_CORE1,        // background benchmark
+} flash_bus_owner_t;
+
+// False if someone else has it. Core 0 only.
+bool flash_bus_acquire(flash_bus_owner_t who);
+// No-op unless 'who' holds it.
+void flash_bus_release(flash_bus_owner_t who);
+flash_bus_owner_t flash_bus_owner(void);
+
 // ========== Web-Safe Benchmark Functions ==========
 void run_fast_benchmark_with_output(printf_func_t output_func);
 void run_benchmark_100_with_output(printf_func_t output_func);
 void run_benchmarks_with_trials_web_safe(int trials, bool save_per_run, bool save_averages, printf_func_t output_func);
 void run_fast_benchmark_web_safe(void);
-void run_benchmarks_with_trials(int trials, bool save_per_run, bool save_averages);
\ No newline at end of file
+void run_benchmarks_with_trials(int trials, bool save_per_run, bool save_averages);
+
+// ========== Plan Engine ==========
+// Every mode above is a plan (bench_plan.h) run by this one loop.
+// trials: the plan's own count if it has one, else this (<1 = N_TRIALS).
+// may_sleep=false keeps every wait a busy-wait (lwIP callback context).
+void bench_run_plan(const bench_plan_t *plan, int trials, bool save_per_run, bool save_averages,
+                    bool may_sleep, printf_func_t out);
+// The built-in plan, or BENCH_PLAN_DIR/plan_<name>.csv when the card has
+// one. The result is a static copy, valid until the next call.
+const bench_plan_t *bench_plan_for(const char *name, const bench_plan_t *builtin, printf_func_t out);
+// Called after every trial with (trials done, trials in the plan, SPI clock).
+// NULL turns it off. The core-1 runner uses it for progress.
+typedef void (*bench_progress_fn)(uint32_t done, uint32_t total, uint32_t hz);
+void bench_set_progress_hook(bench_progress_fn fn);
+// Run BENCH_PLAN_DIR/plan_<name>.csv. With no such file, writes the
+// built-in serial plan there as a template to edit and returns false.
+bool run_benchmark_plan_file(const char *name, int trials, bool save_per_run, bool save_averages);
+
+// ========== Multi-Chip Sweep ==========
+// Same as run_benchmarks_with_trials() on one chip; the previous device
+// stays selected afterwards. Rows carry the chip's CS pin.
+void run_benchmarks_on(flash_dev_t *dev, int trials, bool save_per_run, bool save_averages);
+// Every registered chip select in turn; sockets nothing answers on are skipped.
+void run_benchmarks_all_devices(int trials, bool save_per_run, bool save_averages);
\ No newline at end of file
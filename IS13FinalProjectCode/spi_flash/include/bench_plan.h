@@ -0,0 +1,106 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Benchmark Plans ==========
+// A plan is what the benchmark engine (bench.c) runs: a clock sweep and a
+// list of steps. 'once' steps run before the sweep at their own clock;
+// 'trial' steps run in order, every trial, at each sweep clock; 'clock'
+// steps run once per sweep clock after its trials.
+//
+// The serial, web, 100-run and fast benchmarks are built-in plans, and any
+// of them can be replaced by a file on the card (BENCH_PLAN_DIR/plan_<name>.csv)
+// without reflashing. One line per entry, '#' starts a comment:
+//
+//   title,Fast Benchmark
+//   clocks,12000000,24000000
+//   trials,2               # 0 = the caller's trial count
+//   rotate,64              # 4K sectors the 'rotate' address cycles through
+//   progress,0             # progress line every N trials (0 = none)
+//   trial,ERASE,4096,sweep,-,1,rotate,ERASE_4K
+//   trial,PROG,256,12000000,ramp,1,rotate,PROG_256B
+//   trial,READ,4096,sweep,-,1,rotate,READ_4KB
+//
+// Step fields: kind, op, size, clock ('sweep' or Hz), pattern, repetitions
+// per trial, address policy, and an optional name for the results.csv op
+// column (default: op and size, e.g. PROG_256B).
+
+#define BENCH_PLAN_DIR       "0:/pico_test"
+#define BENCH_PLAN_MAX_STEPS  16
+#define BENCH_PLAN_MAX_CLOCKS 8
+#define BENCH_PLAN_MAX_PROG   4096u    // largest PROG step (one sector of pattern)
+
+typedef enum {
+    PLAN_OP_PROBE = 0,      // flash_probe() + ID/SFDP header
+    PLAN_OP_PREERASE,       // erase the scratch area, skipping blank sectors
+    PLAN_OP_ERASE,          // size 4K, 32K or 64K (skipped if the part lacks it)
+    PLAN_OP_PROG,           // size <= page: one page program; larger: streamed
+    PLAN_OP_READ,           // 'size' bytes through read_data()
+    PLAN_OP_READ_MODES,     // READ seq/rand through each PIO read backend
+    PLAN_OP_READ_ERASE,     // read latency with a 4K erase in flight (wait/suspend)
+    PLAN_OP_READ_CURVE,     // 1-CS reads 16B..'size' (doubling) across the whole chip
+    PLAN_OPS
+} plan_op_t;
+
+typedef enum {
+    PLAN_PAT_NONE = 0,      // '-'
+    PLAN_PAT_RAMP,          // byte i = i
+    PLAN_PAT_MIX,           // byte i = i*7 + (addr >> 8)
+    PLAN_PAT_ZERO,
+    PLAN_PAT_RANDOM,
+    PLAN_PATS
+} plan_pattern_t;
+
+typedef enum {
+    PLAN_ADDR_ROTATE = 0,   // next size-aligned slot of the rotate window each trial
+    PLAN_ADDR_FOLLOW,       // right after where the previous step ended
+    PLAN_ADDR_BASE,         // start of the scratch area
+    PLAN_ADDR_RANDOM,       // random page in the scratch area, per repetition
+                            // (READ_CURVE: random slot anywhere on the chip)
+    PLAN_ADDRS
+} plan_addr_t;
+
+typedef enum { PLAN_ONCE = 0, PLAN_TRIAL, PLAN_CLOCK } plan_kind_t;
+
+typedef struct {
+    plan_kind_t    kind;
+    plan_op_t      op;
+    uint32_t       size;
+    uint32_t       hz;          // 0 = the sweep clock (the first one for 'once')
+    plan_pattern_t pattern;
+    uint16_t       reps;
+    plan_addr_t    addr;
+    char           name[20];    // results.csv op column
+} plan_step_t;
+
+typedef struct {
+    char        title[32];
+    uint32_t    clocks[BENCH_PLAN_MAX_CLOCKS];
+    uint8_t     n_clocks;
+    uint8_t     n_steps;
+    uint16_t    trials;         // 0 = the caller's
+    uint16_t    rotate;         // 0 = the whole scratch area
+    uint16_t    progress;
+    plan_step_t steps[BENCH_PLAN_MAX_STEPS];
+} bench_plan_t;
+
+// Serial benchmark (menu 1/3/m), web benchmark + save, 100-run demo, fast,
+// read throughput vs transfer size (menu c).
+extern const bench_plan_t bench_plan_full;
+extern const bench_plan_t bench_plan_web;
+extern const bench_plan_t bench_plan_demo;
+extern const bench_plan_t bench_plan_fast;
+extern const bench_plan_t bench_plan_curve;
+
+// "0:/pico_test/plan_<name>.csv"
+void bench_plan_path(char *out, unsigned len, const char *name);
+// 0 = loaded, -1 = no such file, else the number of the first line that
+// didn't parse (one past the end if there are no clocks or steps); 'plan'
+// is only changed on success. Mounts the card only if it isn't already.
+int  bench_plan_load(const char *path, bench_plan_t *plan);
+// Write a plan out in the same format (a template to edit).
+bool bench_plan_save(const char *path, const bench_plan_t *plan);
+
+const char *bench_plan_op_name(plan_op_t op);
+// Default results.csv name for a step: "PROG_256B", "ERASE_4K", ...
+void bench_plan_step_name(const plan_step_t *s, char *out, unsigned len);
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "bench.h"      // printf_func_t
+
+// Highest SPI clock each op survives on this chip and wiring. Only the
+// clocks the divider can make are tried (clk_peri / 2k), binary-searched
+// between SPI_FREQ_HZ and clk_peri / 2. A step passes when all
+// CLOCK_TUNE_TRANSFERS randomized transfers are byte-exact:
+//  - read:  read_data() and the CRC verify at the step vs. a floor-clock read
+//  - prog:  page programs at the step, read back at the floor clock
+// Clobbers the first 16KB of the benchmark scratch area.
+typedef struct {
+    uint32_t read_req_hz, read_hz;      // requested / actual baud, 0 = failed at the floor
+    uint32_t prog_req_hz, prog_hz;
+    uint32_t transfers;                 // per clock step
+} clock_tune_t;
+
+bool clock_tune_run(clock_tune_t *res, printf_func_t out);
+
+// One row per JEDEC ID in CLOCK_TUNE_PATH; save replaces the chip's row.
+bool clock_tune_save(const uint8_t id[3], const clock_tune_t *res);
+bool clock_tune_load(const uint8_t id[3], clock_tune_t *res);
+
+// Run the current chip at the lower of its stored read/prog ceilings.
+// Returns the actual baud, or 0 (clock unchanged) with no stored result.
+uint32_t clock_tune_apply(void);
@@ -5,7 +5,6 @@
 // =======================
 // Global build-time config
 // =======================
-#define FLASH_SIZE_BYTES  (4 * 1024 * 1024)
 
 // ---- SPI Flash (spi0) pins ----
 #define PIN_SCK   2
@@ -13,8 +12,27 @@
 #define PIN_MISO  4
 #define PIN_CS    6
 
+// One flash device per chip select on the same bus, swept in this order.
+// The first must be PIN_CS (the PIO readers check it against IO2/IO3).
+#ifndef FLASH_CS_PINS
+#define FLASH_CS_PINS     { PIN_CS }
+#endif
+#define FLASH_MAX_DEVS    4
+
+// ---- Multi-lane reads (PIO backend, flash_qspi.c) ----
+// Dual modes reuse MOSI/MISO as IO0/IO1. Quad modes also need WP#/HOLD#
+// wired as IO2/IO3 on the two GPIOs right after MISO (PIO reads consecutive
+// pins), which collides with CS on GP6 in the default wiring. Move CS and
+// set this to 1 to enable the 1-1-4 / 1-4-4 rows.
+#ifndef FLASH_QUAD_WIRED
+#define FLASH_QUAD_WIRED  0
+#endif
+#define PIN_IO2   (PIN_MISO + 1)
+#define PIN_IO3   (PIN_MISO + 2)
+#define QIO_DUMMY_CLOCKS  4      // 0xEB wait cycles after the mode byte
+
 // ---- SPI frequencies (Hz) you want to sweep for benchmarks ----
-#define N_FREQS   3
+#define N_FREQS   4
 
 // Conservative clock just for program+verify (helps with breadboard wiring)
 #define SAFE_PROG_HZ  12000000u
@@ -31,10 +49,24 @@
 // ---- Operation timeouts (microseconds) ----
 #define TOUT_ERASE_US  (800 * 1000)    // 4KB erase timeout (adjust per chip)
 #define TOUT_PROG_US   (5 * 1000)      // 256B program timeout
+#define TOUT_ERASE32_US (2000 * 1000)  // 32KB block erase timeout
+#define TOUT_ERASE64_US (3000 * 1000)  // 64KB block erase timeout
+#define TOUT_CHIP_US   (200u * 1000u * 1000u)  // whole-chip erase (8MB parts can take ~100 s)
+
+// 32K/64K erase rows are clock-independent and slow; run them this many times
+#define BLOCK_ERASE_TRIALS 10
+
+// Reads per serving mode (wait vs suspend) in the read-while-erase benchmark
+#define RWE_SAMPLES 50
 
 // Raise after wiring is proven solid (try 8 or 12 MHz)
 #define SPI_FREQ_HZ       (4 * 1000 * 1000)   // 4 MHz
 
+// Clock auto-tune (clock_tune.c): SPI_FREQ_HZ is the trusted floor, and
+// every clock step must pass this many randomized transfers per op.
+#define CLOCK_TUNE_PATH      "0:/pico_test/clock_tune.csv"
+#define CLOCK_TUNE_TRANSFERS 32
+
 /* ========== "Fast benchmark" sizes (quick per-run work) ========== */
 #define RUNS                100
 
@@ -52,10 +84,23 @@
 // === Benchmark Averages CSV (summary) ===
 #define BENCH_PATH "0:/pico_test/benchmark.csv"
 
+// === Flash backup ===
+// 1: compressed .fbk container (flash_pack.h), 0: raw .bin dump.
+// Restore reads either format.
+#ifndef FLASH_BACKUP_COMPRESS
+#define FLASH_BACKUP_COMPRESS 1
+#endif
+#if FLASH_BACKUP_COMPRESS
+#define FLASH_BACKUP_PATH "0:/pico_test/flash_backup.fbk"
+#else
+#define FLASH_BACKUP_PATH "0:/pico_test/flash_backup.bin"
+#endif
+
 /* =================== SPI FLASH HELPERS =================== */
 
 #define CSV_PATH "0:/pico_test/results.csv"
 
+// Fallback capacity until flash_probe() reads it from SFDP / the JEDEC ID.
 // 64Mbit ISSI IS25LP064A = 8 * 1024 * 1024 bytes
 #ifndef FLASH_TOTAL_BYTES
 #define FLASH_TOTAL_BYTES (8u * 1024u * 1024u)
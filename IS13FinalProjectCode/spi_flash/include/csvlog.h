@@ -2,6 +2,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ff.h"   // FatFs
+#include "flash.h"  // flash_phase_log_t
+#include "lat_stats.h"
 
 // File locations
 #define CSV_PATH   "0:/pico_test/results.csv"
@@ -10,9 +12,11 @@
 // Per-run CSV (results.csv)
 FRESULT csv_begin(void);
 void    csv_end(void);
+// phases: per-phase clk_sys cycles for the row; NULL leaves those columns empty
 void    csv_row_to_sd(bool save, int run, const char* op, uint32_t hz,
                       uint32_t addr, uint32_t bytes, int64_t dur_us,
-                      double mbps, uint32_t verify_errors, uint8_t sr1_end);
+                      double mbps, uint32_t verify_errors, uint8_t sr1_end,
+                      const flash_phase_log_t *phases);
 
 // Session markers (to erase the latest saved test)
 DWORD   csv_mark_session_start(void);
@@ -29,7 +33,14 @@ void bench_csv_append_avg(const char *jedec_hex,
                           double avg_write_kBps,
                           double avg_readseq_kBps,
                           double avg_readrand_MBps,
-                          uint32_t verify_errors);
+                          uint32_t verify_errors,
+                          const char *read_mode,    // "1-1-1", "1-1-4", ...
+                          double avg_erase32_ms,    // 0 = not measured
+                          double avg_erase64_ms,
+                          // per-op latency spread; NULL leaves the columns empty
+                          const lat_stats_t *erase,
+                          const lat_stats_t *write,
+                          const lat_stats_t *readseq);
 void    bench_csv_end(void);
 FRESULT csv_truncate_to(DWORD pos);
 void csv_undo_current_session(void);
\ No newline at end of file
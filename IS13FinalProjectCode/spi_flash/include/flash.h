@@ -1,11 +1,82 @@
 #ifndef FLASH_H
 #define FLASH_H
 #include "ff.h" 
+#include "sfdp.h"
+#include "hardware/spi.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+// Set up spi0, register one device per FLASH_CS_PINS entry (all CS high)
+// and select the first.
 void flash_init_spi(uint32_t hz);
 
+// ---- Devices ----
+// A flash_dev_t is one chip: its bus, CS pin, clock and the profile
+// flash_probe() detected (command set, SFDP, erase sizes, busy-time
+// estimates). Every call in this header acts on the selected device, so
+// probe/benchmark each chip in turn by selecting it first.
+typedef struct flash_dev flash_dev_t;
+
+// Register a chip (CS driven high). Returns the existing handle for a
+// known bus/pin, or NULL once FLASH_MAX_DEVS are in use.
+flash_dev_t *flash_dev_add(spi_inst_t *spi, uint cs_pin);
+unsigned flash_dev_count(void);
+flash_dev_t *flash_dev_get(unsigned idx);     // NULL past the end
+// Waits out an async read and restores the device's clock. False while a
+// flash_op_* operation is running or suspended on the current device.
+bool flash_dev_select(flash_dev_t *dev);
+flash_dev_t *flash_dev_current(void);
+uint flash_dev_cs_pin(const flash_dev_t *dev);  // NULL = current
+// Bus of the selected device (SFDP and PIO readers share it).
+spi_inst_t *flash_spi(void);
+
+// Change the flash SPI clock; returns the baud the divider actually gives.
+uint32_t flash_set_clock(uint32_t hz);
+// Clock last asked for on the selected device (not the divider's result).
+uint32_t flash_get_clock(void);
+
+// Read the JEDEC ID and pick the command set for that part: Fast Read
+// (0x0B + dummy byte) for everything that answers, and 4-byte addressing
+// (0x0C/0x12/0x21, or EN4B where those opcodes are missing) above 16 MB.
+// If the part has SFDP, its tables decide density, page size, address
+// mode, the erase sizes/opcodes on offer and seed the busy-time profiles.
+// SST parts (0xBF) are unlocked here and SST25 switches to AAI programming.
+// Returns the capacity in bytes, or 0 if unknown / nothing responded.
+uint32_t flash_probe(void);
+// Probed capacity, or FLASH_TOTAL_BYTES before a successful probe.
+uint32_t flash_capacity_bytes(void);
+void flash_enter_4byte_mode(void);
+
+// Parsed SFDP tables from the last probe, or NULL if the part has none.
+const sfdp_info_t *flash_sfdp(void);
+// Program page size (SFDP, else 256).
+uint32_t flash_page_size(void);
+// 4K always; 32K/64K only if SFDP lists them (or there's no SFDP); chip size.
+bool flash_erase_supported(uint32_t size);
+
+// Address width in use, and whether it comes from the dedicated 4-byte
+// opcodes (0x0C/0x12/0x21) rather than EN4B or plain 3-byte addressing.
+uint8_t flash_addr_bytes(void);
+bool flash_uses_4byte_opcodes(void);
+
+// Read backends for read_data(), named command-address-data lanes.
+// 1-1-1 is the hardware SPI; the rest run through PIO (flash_qspi.c).
+typedef enum {
+    FLASH_READ_1_1_1 = 0,   // 0x0B Fast Read
+    FLASH_READ_1_1_2,       // 0x3B Dual Output
+    FLASH_READ_1_1_4,       // 0x6B Quad Output
+    FLASH_READ_1_4_4,       // 0xEB Quad I/O
+    FLASH_READ_MODES
+} flash_read_mode_t;
+
+// Returns false (and keeps the current backend) if the mode can't run with
+// this part/wiring, or SFDP doesn't list it. flash_probe() drops back to 1-1-1.
+bool flash_set_read_mode(flash_read_mode_t mode);
+// Clocks between address and data (mode bits + wait states) for a mode.
+uint8_t flash_read_wait_clocks(flash_read_mode_t mode);
+flash_read_mode_t flash_get_read_mode(void);
+const char *flash_read_mode_name(flash_read_mode_t mode);
+
 void cs_low(void);
 void cs_high(void);
 
@@ -13,11 +84,178 @@ void read_jedec_id(uint8_t id[3]);
 bool read_sfdp_header(uint8_t hdr8[8]);
 uint8_t read_status(uint8_t which);  // 0x05 or 0x35
 void write_enable(void);
-void wait_wip_clear(void);
+
+// ---- Busy (WIP) wait ----
+// Polls SR1 with one continuous RDSR (CS held low, status clocked out
+// repeatedly). Stays off the bus for the first half of the expected busy
+// time, polls back-to-back around it, then backs off towards the part's
+// max. Gives up after TOUT_PROG_US / TOUT_ERASE_US, or the datasheet max
+// if that is longer.
+typedef enum {
+    FLASH_WAIT_PROG = 0,     // page program
+    FLASH_WAIT_ERASE_4K,
+    FLASH_WAIT_ERASE_32K,
+    FLASH_WAIT_ERASE_64K,
+    FLASH_WAIT_CHIP,         // chip erase
+    FLASH_WAIT_OTHER,        // status writes etc: erase timeout, no learning
+    FLASH_WAIT_KINDS
+} flash_wait_kind_t;
+
+// Datasheet typical/max busy time (0 = unknown); also reseeds the estimate.
+void flash_set_timing(flash_wait_kind_t kind, uint32_t typ_us, uint32_t max_us);
+// may_sleep=false busy-waits instead (lwIP callback context).
+// Returns false on timeout.
+bool flash_wait_ready(flash_wait_kind_t kind, bool may_sleep);
+// Busy time seen by the last successful wait (from the call to WIP clear).
+uint32_t flash_last_busy_us(void);
+
+bool wait_wip_clear(void);
+bool wait_wip_clear_web_safe(void);
 
 void read_data(uint32_t addr, uint8_t *buf, uint32_t len);
-void page_program(uint32_t addr, const uint8_t *buf, uint32_t len);
-void sector_erase_4k(uint32_t addr);
+
+// DMA-backed async read. Returns as soon as the transfer is running; 'done'
+// is called from the DMA IRQ (CS already released) when the data has landed.
+// Any other flash call waits for the transfer to finish first.
+typedef void (*flash_read_cb_t)(void *ctx);
+void read_data_async(uint32_t addr, uint8_t *buf, uint32_t len,
+                     flash_read_cb_t done, void *ctx);
+bool flash_read_busy(void);
+void flash_read_wait(void);
+
+// 'len' bytes clocked in under one chip select and dropped (DMA into a
+// sink byte, no CRC), for timing reads of any size without a buffer.
+// 1-1-1 only: false, and nothing read, in a PIO read mode.
+bool flash_read_discard(uint32_t addr, uint32_t len);
+
+// ---- Phase timing ----
+// Splits an operation at its protocol boundaries, in clk_sys cycles
+// (SysTick, with the 1 us timer to count its wraps). Phases are summed, so
+// a streamed write adds up every page. Off unless armed; a mark is a
+// flag test then.
+typedef enum {
+    FLASH_PH_WREN = 0,      // write enable (and WEL check on the async path)
+    FLASH_PH_CMD,           // opcode + address (+ dummy) bytes
+    FLASH_PH_DATA,          // data bytes clocked in or out
+    FLASH_PH_WIP,           // CS high until WIP clears
+    FLASH_PH_STATUS,        // caller's read_status() afterwards
+    FLASH_PHASES
+} flash_phase_t;
+
+typedef struct {
+    uint32_t cycles[FLASH_PHASES];
+    uint32_t sys_mhz;       // clk_sys when armed: cycles / sys_mhz = us
+} flash_phase_log_t;
+
+// Arm and zero the log; time from here to the first mark is that mark's.
+void flash_phase_begin(void);
+// Time since the previous mark goes to 'ph'.
+void flash_phase_mark(flash_phase_t ph);
+// Disarm and copy the log out (log may be NULL).
+void flash_phase_end(flash_phase_log_t *log);
+const char *flash_phase_name(flash_phase_t ph);
+
+// ---- CRC32 verify ----
+// CRC-32 (IEEE polynomial, MSB first, no final XOR) as the RP2040 DMA
+// sniffer computes it: of a flash region streamed off the bus without a
+// buffer, and of a RAM buffer by a DMA pass.
+#define FLASH_CRC32_SEED 0xFFFFFFFFu
+uint32_t flash_crc32(uint32_t addr, uint32_t len);
+uint32_t flash_crc32_buf(const uint8_t *p, uint32_t len);
+// The same CRC in software, continuing from 'crc' (for chaining).
+uint32_t flash_crc32_sw(uint32_t crc, const uint8_t *p, uint32_t len);
+// 0 if flash matches 'expect'; otherwise the number of mismatched bytes
+// (counted by a read-back that only runs when the CRCs differ).
+uint32_t flash_verify(uint32_t addr, const uint8_t *expect, uint32_t len);
+
+// Both return false if the part is still busy at the timeout.
+bool page_program(uint32_t addr, const uint8_t *buf, uint32_t len);
+bool sector_erase_4k(uint32_t addr);
+
+// ---- Block / chip erase ----
+// 'size' is 4K, 32K (0x52), 64K (0xD8) or flash_capacity_bytes() for a
+// chip erase (0xC7, addr 0). addr must be aligned to size.
+bool flash_erase_block(uint32_t addr, uint32_t size);
+// Planner: the largest aligned erase that starts at addr and stays below
+// end (whole chip if [0, end) covers it). 0 if addr isn't 4K aligned.
+uint32_t flash_erase_plan_step(uint32_t addr, uint32_t end);
+// Erase [addr, addr+len) rounded out to 4K with the fewest planned erases.
+// Sectors that already read back blank are left alone.
+bool flash_erase_range(uint32_t addr, uint32_t len, bool may_sleep);
+
+// ---- Blank check ----
+// Bulk reads compared a word at a time against 0xFFFFFFFF; stops at the
+// first programmed byte, and the first read is only a page so a used
+// sector costs next to nothing to reject.
+bool flash_is_blank(uint32_t addr, uint32_t len);
+bool flash_buf_is_blank(const uint8_t *p, uint32_t len);
+// Like flash_erase_plan_step(), but 0 if the 4K sector at addr is already
+// blank (move on 4K), and the plan stops short of the next blank sector.
+uint32_t flash_erase_plan_dirty(uint32_t addr, uint32_t end);
+
+typedef struct {
+    uint32_t checked;      // 4K sectors blank-checked
+    uint32_t skipped;      // already blank, not erased
+    uint32_t check_us;     // time spent reading for the checks
+    uint32_t saved_us;     // skipped x the current 4K erase estimate
+} flash_blank_stats_t;
+void flash_blank_stats_reset(void);
+flash_blank_stats_t flash_blank_stats(void);
+
+// Program any length from any address: split on page boundaries, with the
+// next page copied into a DMA staging buffer while the current one is
+// busy, so pages go back to back at the part's tPP. Busy-waits (web-safe).
+// False on a program timeout; the range must already be erased.
+bool flash_write_stream(uint32_t addr, const uint8_t *src, uint32_t len);
+
+// Issue WREN + command only; the caller waits for WIP to clear. On SST25
+// (AAI word program) the program itself runs here and WIP is already clear.
+void page_program_start(uint32_t addr, const uint8_t *buf, uint32_t len);
+void sector_erase_4k_start(uint32_t addr);
+
+// ---- Non-blocking erase/program ----
+// One operation at a time, run as WREN -> command -> WIP. Submit returns as
+// soon as the command is on its way; flash_op_poll() advances it with a
+// single RDSR per call and never blocks, so the caller can service SD/lwIP
+// in between. 'done' runs from inside flash_op_poll() when it finishes.
+// Completion is seen at poll granularity, so elapsed is an upper bound.
+typedef enum {
+    FLASH_OP_IDLE = 0,
+    FLASH_OP_BUSY,
+    FLASH_OP_DONE,
+    FLASH_OP_FAILED,         // WEL never set, or still busy at the timeout
+    FLASH_OP_SUSPENDED       // parked by flash_op_suspend(); reads are allowed
+} flash_op_state_t;
+
+typedef void (*flash_op_cb_t)(bool ok, uint32_t elapsed_us, void *ctx);
+
+// False if another operation is still running. 'data' must stay valid
+// until the operation completes.
+bool flash_op_submit_erase_4k(uint32_t addr, flash_op_cb_t done, void *ctx);
+bool flash_op_submit_erase(uint32_t addr, uint32_t size, flash_op_cb_t done, void *ctx);
+bool flash_op_submit_program(uint32_t addr, const uint8_t *data, uint32_t len,
+                             flash_op_cb_t done, void *ctx);
+flash_op_state_t flash_op_poll(void);
+// Poll until the current operation finishes (may_sleep as flash_wait_ready).
+// Returns FLASH_OP_SUSPENDED straight away if it is parked.
+flash_op_state_t flash_op_wait(bool may_sleep);
+// Time since the command went out (final value once finished), not
+// counting time spent suspended.
+uint32_t flash_op_elapsed_us(void);
+
+// ---- Erase/program suspend ----
+// Opcodes and latencies come from SFDP (DWORD 12/13), else 0x75/0x7A.
+// Suspend parks the running op once it is in its WIP phase: it waits out
+// the suspend latency and checks SUS in SR2 (erase bit 7, program bit 2)
+// on parts that report it there, WIP otherwise. Returns false if there is
+// nothing to suspend, or the op finished first (state is then DONE).
+// Resume honours the part's minimum resume-to-suspend gap on the next
+// suspend. Don't read the block being erased/programmed while suspended.
+bool flash_suspend_supported(void);
+bool flash_op_suspend(void);
+bool flash_op_resume(void);
+// SR2 SUS bits (0 on parts that don't keep them there).
+uint8_t flash_sus_status(void);
 
 // add these only if you implement them here:
 void flash_soft_reset(void);
@@ -26,11 +264,41 @@ void flash_recover_to_safe_mode(void);
 
 // Backup entire SPI flash to a file on the SD card.
 // 'flash_bytes' = total capacity to read (e.g., 8*1024*1024).
-FRESULT flash_backup_to_file(const char *path, uint32_t flash_bytes);
+// 'compress' writes the .fbk container (flash_pack.h) instead of a raw dump.
+// Progress is checkpointed every 64KB to '<path>.jnl'; a run that finds a
+// journal for the same chip and format carries on from the last checkpoint.
+FRESULT flash_backup_to_file(const char *path, uint32_t flash_bytes, bool compress);
+// Flash bytes a backup file holds: the header's image size for .fbk, else
+// the file size.
+FRESULT flash_backup_image_bytes(const char *path, uint32_t *bytes);
+
+// Restore from a file into SPI flash (erases as needed). Takes either a
+// raw dump or a .fbk container, told apart by the header.
+// It writes up to min(image size, flash_bytes).
+// If 'verify' is true, each 4KB block is CRC-checked against the file.
+// If 'diff' is true, each 4KB sector is compared with the file first and
+// only what changed is rewritten: identical sectors are skipped, 1->0-only
+// changes are programmed without an erase. Parts that forbid programming a
+// page twice (on-die ECC) need diff = false.
+// Like a backup, an interrupted restore resumes from '<path>.jnl'.
+FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool verify, bool diff);
 
-// Restore from a file into SPI flash (erases as needed).
-// It writes up to min(file_size, flash_bytes).
-// If 'verify' is true, each 4KB block is read back & compared.
-FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool verify);
+// Read-only check of the chip against a backup (raw or .fbk): a CRC per
+// 64KB extent first, then per 4KB sector inside the extents that differ.
+// Prints progress and the map on serial; FR_OK means the compare ran, not
+// that the chip matches (see sectors_differ).
+#define FLASH_CMP_MAP_SECTORS 8192u     // 4KB sectors the map covers (32 MB)
+typedef struct {
+    uint32_t bytes;             // compared, from 0
+    uint32_t sectors_differ;
+    uint32_t extents_differ;    // 64KB
+    uint32_t elapsed_ms;
+    uint8_t  map[FLASH_CMP_MAP_SECTORS / 8u];   // bit per sector, set = differs
+} flash_cmp_result_t;
+FRESULT flash_compare_to_file(const char *path, uint32_t flash_bytes, flash_cmp_result_t *res);
+bool flash_cmp_sector_differs(const flash_cmp_result_t *res, uint32_t addr);
+// Summary, a 64KB-per-column map and the differing address ranges.
+typedef void (*flash_out_fn)(const char *fmt, ...);
+void flash_cmp_print_map(const flash_cmp_result_t *res, flash_out_fn out);
 
 #endif
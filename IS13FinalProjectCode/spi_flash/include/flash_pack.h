@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Compressed backup container (.fbk). A 32-byte header, then one record
+// per 4 KB block of flash in address order. Blocks are coded on their own,
+// so a restore can stream the file without looking back. All fields are
+// little-endian.
+//
+//   header: "FBK1", u16 version, u16 header bytes, JEDEC[3], u8 0,
+//           u32 capacity, u32 image bytes, u32 block bytes,
+//           u32 image CRC (over the block CRCs in order), u32 header CRC
+//   record: u8 encoding, u8 0, u16 payload bytes, u32 block CRC, payload
+//
+// CRCs are the flash_crc32() flavour, so a block can be checked against
+// flash with the DMA sniffer.
+
+#define FPACK_MAGIC        "FBK1"
+#define FPACK_VERSION      1u
+#define FPACK_HDR_BYTES    32u
+#define FPACK_REC_BYTES    8u
+#define FPACK_BLOCK        4096u
+
+typedef enum {
+    FPACK_ERASED = 0,       // all 0xFF, no payload
+    FPACK_RLE,              // PackBits runs
+    FPACK_LZ,               // LZSS, 4 KB window (the block itself)
+    FPACK_RAW               // stored as is
+} fpack_enc_t;
+
+typedef struct {
+    uint8_t  jedec[3];
+    uint32_t capacity;
+    uint32_t image_bytes;
+    uint32_t block_bytes;
+    uint32_t image_crc;
+} fpack_hdr_t;
+
+typedef struct {
+    uint8_t  enc;           // fpack_enc_t
+    uint16_t len;           // payload bytes
+    uint32_t crc;           // CRC of the decoded block
+} fpack_rec_t;
+
+void fpack_hdr_write(const fpack_hdr_t *h, uint8_t out[FPACK_HDR_BYTES]);
+// False if the magic, version or header CRC is wrong.
+bool fpack_hdr_read(const uint8_t in[FPACK_HDR_BYTES], fpack_hdr_t *h);
+void fpack_rec_write(const fpack_rec_t *r, uint8_t out[FPACK_REC_BYTES]);
+void fpack_rec_read(const uint8_t in[FPACK_REC_BYTES], fpack_rec_t *r);
+
+// Code one block (len <= FPACK_BLOCK) into 'out' (FPACK_BLOCK bytes) with
+// whichever encoding comes out smallest. Returns the payload length and
+// sets *enc; never longer than len (RAW is the fallback).
+uint32_t fpack_encode(const uint8_t *blk, uint32_t len, uint8_t *out, fpack_enc_t *enc);
+// Decode a payload into exactly out_len bytes. False on a corrupt payload.
+bool fpack_decode(fpack_enc_t enc, const uint8_t *in, uint32_t in_len,
+                  uint8_t *out, uint32_t out_len);
+const char *fpack_enc_name(fpack_enc_t enc);
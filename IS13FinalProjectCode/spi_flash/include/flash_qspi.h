@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash.h"
+
+// PIO backend for the multi-lane read modes of read_data().
+// The hardware SPI sends the opcode (plus address and dummy byte for the
+// 1-1-x reads) and PIO clocks the rest on 2 or 4 lanes, at the same SCK the
+// SPI is set to (capped at clk_sys/4).
+
+// Load the PIO programs and claim a state machine + DMA channel (lazy).
+bool flash_qspi_init(void);
+
+// Check the mode can run with this wiring/part and set QE if it needs it.
+bool flash_qspi_prepare(flash_read_mode_t mode);
+
+// Set the Quad Enable bit (non-volatile) using the vendor's status layout.
+bool flash_quad_enable(void);
+
+void flash_qspi_read(flash_read_mode_t mode, uint32_t addr, uint8_t *buf, uint32_t len);
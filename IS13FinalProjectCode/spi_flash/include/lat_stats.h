@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Constant-memory latency summary for one op at one clock: Welford
+// mean/variance, min/max, and the quantiles in LAT_STATS_P. The first
+// LAT_STATS_EXACT samples are kept and give exact quantiles; past that,
+// P² (Jain & Chlamtac, 1985) markers seeded from them take over.
+// A zeroed struct is an empty one.
+#ifndef LAT_STATS_EXACT
+#define LAT_STATS_EXACT 128u    // 512 bytes; covers the usual 10-100 trial runs
+#endif
+#define LAT_STATS_QUANTILES 3
+extern const double LAT_STATS_P[LAT_STATS_QUANTILES];   // 0.50, 0.95, 0.99
+
+typedef struct {            // one P² estimator: five markers
+    double  q[5];           // heights
+    double  want[5];        // desired positions
+    int32_t pos[5];         // actual positions, 1-based
+} lat_p2_t;
+
+typedef struct {
+    uint32_t n;
+    double   mean, m2;      // Welford
+    double   min, max;
+    float    first[LAT_STATS_EXACT];     // sorted
+    lat_p2_t p2[LAT_STATS_QUANTILES];
+} lat_stats_t;
+
+void   lat_stats_add(lat_stats_t *s, double x);
+double lat_stats_stddev(const lat_stats_t *s);       // sample stddev, 0 below two samples
+// Estimate of LAT_STATS_P[i]; 0 when empty.
+double lat_stats_quantile(const lat_stats_t *s, unsigned i);
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// JESD216 SFDP: header, parameter headers, Basic Flash Parameter Table
+// (BFPT) and, if present, the 4-byte Address Instruction Table (4BAIT).
+// Fields the part's table is too short to carry are left at 0.
+
+#define SFDP_ADDR_3        0    // 3-byte only
+#define SFDP_ADDR_3_OR_4   1    // 3-byte default, 4-byte on request
+#define SFDP_ADDR_4        2    // 4-byte only
+
+typedef struct {
+    bool    supported;
+    uint8_t opcode;
+    uint8_t dummy_clocks;       // wait states after the address
+    uint8_t mode_clocks;        // mode-bit clocks before the wait states
+} sfdp_read_t;
+
+typedef struct {
+    uint32_t size;              // 0 = slot unused
+    uint8_t  opcode;
+    uint8_t  opcode_4b;         // from 4BAIT, 0 if not listed
+    uint32_t typ_us, max_us;    // BFPT DWORD 10 (rev B+)
+} sfdp_erase_t;
+
+typedef struct {
+    uint8_t  rev_major, rev_minor;      // BFPT revision
+    uint8_t  bfpt_dwords;
+    uint32_t density_bytes;
+    uint8_t  addr_mode;                 // SFDP_ADDR_*
+    uint32_t page_size;
+    sfdp_erase_t erase[4];
+    sfdp_read_t  read_112, read_122, read_114, read_144;
+    uint32_t prog_typ_us, prog_max_us;  // page program
+    uint32_t chip_typ_us, chip_max_us;  // chip erase
+    bool     has_suspend;               // DWORD 12 bit 31 clear
+    uint8_t  erase_suspend_op, erase_resume_op;   // DWORD 13
+    uint8_t  prog_suspend_op, prog_resume_op;
+    uint32_t erase_suspend_us, prog_suspend_us;   // max suspend latency
+    uint32_t erase_resume_gap_us, prog_resume_gap_us;  // resume -> next suspend
+    bool     has_qe_req;
+    uint8_t  qe_req;                    // DWORD 15 [22:20]
+    uint8_t  enter_4b;                  // DWORD 16 [31:24] method bits
+    bool     has_4bait;
+    uint32_t bait_support;              // 4BAIT DWORD 1
+} sfdp_info_t;
+
+// Read SFDP at 'addr' (0x5A, 3-byte address, 8 dummy clocks).
+void sfdp_read(uint32_t addr, uint8_t *buf, uint32_t len);
+
+// Parse the part's tables; false if there's no SFDP or no usable BFPT.
+bool sfdp_parse(sfdp_info_t *out);
+
+void sfdp_print(const sfdp_info_t *s);
@@ -10,3 +10,6 @@ void action_show_network_status(void);
 // new backup/restore menu actions
 void action_backup_flash(void);
 void action_restore_flash(void);
+void action_verify_flash(void);
+// Search, save to CLOCK_TUNE_PATH and switch to the chip's max reliable clock
+void action_tune_clock(void);
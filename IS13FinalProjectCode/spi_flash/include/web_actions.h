@@ -1,6 +1,8 @@
 #ifndef WEB_ACTIONS_H
 #define WEB_ACTIONS_H
 
+#include <stdbool.h>
+
 // Web-specific implementations of menu actions
 // These functions capture output for web display instead of serial
 
@@ -16,7 +18,16 @@ void web_show_status(void);
 // Fast benchmark - runs on Core 0 (no dual-core complexity)
 void web_run_fast_benchmark(void);
 
+// Background benchmark on Core 1: web_run_benchmark() starts it,
+// web_benchmark_status() shows progress and, once done, the results.
+void web_benchmark_status(void);
+// Claims the flash bus for a web action and returns false; true (and
+// explains why) while Core 1 or a serial action has it. Release with
+// flash_bus_release(FLASH_BUS_WEB).
+bool web_flash_busy(void);
+
 void web_backup_flash(void);
 void web_restore_flash(void);
+void web_verify_flash(void);
 
 #endif // WEB_ACTIONS_H
\ No newline at end of file
@@ -41,6 +41,12 @@ void send_file_download(struct tcp_pcb *pcb, const char *path_qs);
  * @param success Whether upload succeeded
  */
 void send_upload_response(struct tcp_pcb *pcb, const char *filename, uint32_t bytes_received, bool success);
-bool sd_ok(void);
+
+// SD probe for the status panels. It mounts and unmounts the card, so
+// while anything owns the flash bus it reports SD_IN_USE without
+// touching FatFs (an unmount would pull the volume from under it).
+typedef enum { SD_ABSENT = 0, SD_PRESENT, SD_IN_USE } sd_status_t;
+sd_status_t sd_status(void);
+const char *sd_status_name(sd_status_t st);     // "Connected", ...
 
 #endif // WEB_PAGES_H
\ No newline at end of file
@@ -1,7 +1,17 @@
 #include "flash.h"
+#include "flash_qspi.h"
+#include "flash_pack.h"
+#include "sfdp.h"
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
 #include "ff.h"          // FatFs
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "config.h"  // where PIN_* live
 
@@ -12,10 +22,272 @@
 #define FLASH_ERASE_SIZE  4096u      // 4KB sectors
 #endif
 
+#ifndef FLASH_DMA_MIN_BYTES
+#define FLASH_DMA_MIN_BYTES 32u      // below this, channel setup costs more than it saves
+#endif
+#ifndef FLASH_AAI_WORD_TOUT_US
+#define FLASH_AAI_WORD_TOUT_US 100u  // SST25 AAI word/byte program, 10 us max on the datasheet
+#endif
+#ifndef FLASH_STAGE_BYTES
+#define FLASH_STAGE_BYTES 256u       // flash_write_stream() staging buffer; bigger pages are split
+#endif
+#ifndef FLASH_BLANK_CHUNK
+#define FLASH_BLANK_CHUNK 1024u      // blank-check read size; the first read is a page, for an early out
+#endif
+#ifndef FLASH_BACKUP_CHUNK
+#define FLASH_BACKUP_CHUNK (8u * 1024u)   // raw backup: flash read / f_write size (multiple of 512)
+#endif
+#ifndef FLASH_BACKUP_BUFS
+#define FLASH_BACKUP_BUFS 3u             // raw backup ring depth
+#endif
+#define FLASH_SNIFF_CRC32 0x0u       // SNIFF_CTRL.CALC: CRC-32 (IEEE poly), MSB first
+
 static FATFS g_fs;
 
-void cs_low(void)  { gpio_put(PIN_CS, 0); }
-void cs_high(void) { gpio_put(PIN_CS, 1); }
+// ---- DMA read channels ----
+// Same scheme as FatFs_SPI's spi_transfer(): a TX channel clocks out dummy
+// bytes while an RX channel drains the FIFO into the caller's buffer. Only
+// RX raises an interrupt, since RX complete implies TX complete.
+// The SD driver uses DMA_IRQ_0, so the flash bus takes DMA_IRQ_1.
+static int  s_dma_tx = -1;
+static int  s_dma_rx = -1;
+static dma_channel_config s_dma_tx_cfg;
+static dma_channel_config s_dma_rx_cfg;
+static int  s_dma_crc = -1;          // memory pass for flash_crc32_buf(), free of the read pair
+
+// ---- Program backends ----
+typedef enum {
+    PROG_PAGE = 0,          // 0x02/0x12 page program, one WIP wait per page
+    PROG_AAI                // SST25: 0xAD auto-address-increment words, WRDI to end
+} prog_path_t;
+
+// ---- WIP wait profiles ----
+#ifndef FLASH_POLL_MAX_STEP_US
+#define FLASH_POLL_MAX_STEP_US 2000u    // longest gap between polls once past the estimate
+#endif
+
+typedef struct {
+    uint32_t typ_us;     // datasheet typical (0 = unknown)
+    uint32_t max_us;     // datasheet max
+    uint32_t tout_us;    // hard limit from config.h
+    uint32_t est_us;     // running estimate: typ, then EWMA of measured times
+} wait_profile_t;
+
+static const char *const s_wait_name[FLASH_WAIT_KINDS] = {
+    "program", "erase 4K", "erase 32K", "erase 64K", "chip erase", "status"
+};
+static uint32_t s_last_busy_us = 0;
+
+// ---- Devices ----
+// One per chip select. Everything flash_probe() learns about a part lives
+// here, so each chip keeps its own command set and busy-time estimates
+// while the others are being driven. The flash_* calls act on s_cur.
+struct flash_dev {
+    spi_inst_t *spi;
+    uint        cs_pin;
+    uint32_t    hz;                  // clock last set on this device
+
+    // Command set. Defaults are the legacy 3-byte commands every SPI NOR
+    // understands; flash_probe() upgrades them once it knows the part.
+    uint8_t  op_read;
+    uint8_t  read_dummy;             // dummy bytes between address and data
+    uint8_t  op_prog;
+    uint8_t  op_erase4k, op_erase32k, op_erase64k;
+    uint8_t  addr_bytes;
+    bool     en4b;                   // part latched into 4-byte mode by EN4B
+    bool     op4b;                   // dedicated 4-byte opcodes in use
+    uint32_t capacity;
+    uint32_t page_size;
+
+    prog_path_t prog_path;
+    uint8_t     sst_type;            // SST memory type (0x25/0x26), 0 for other vendors
+
+    // SFDP profile from the last probe; erase opcodes of 0 mean "no such size"
+    sfdp_info_t sfdp;
+    bool        has_sfdp;
+
+    // Suspend/resume. SUS lives in SR2 on Winbond (bit 7, both kinds) and
+    // GigaDevice (SUS1 bit 7 erase, SUS2 bit 2 program); Macronix/ISSI keep
+    // it in other registers, so there a suspend is judged by WIP alone.
+    bool     sus_ok;
+    uint8_t  op_esus, op_eres;
+    uint8_t  op_psus, op_pres;
+    uint32_t esus_us, psus_us;       // suspend latency (max)
+    uint32_t egap_us, pgap_us;       // resume -> next suspend
+    uint8_t  sus_erase_sr2, sus_prog_sr2;
+
+    flash_read_mode_t read_mode;
+    wait_profile_t    wait[FLASH_WAIT_KINDS];
+};
+
+#define FLASH_DEV_INIT(bus, pin) {                                          \
+    .spi = (bus), .cs_pin = (pin), .hz = SPI_FREQ_HZ,                       \
+    .op_read = 0x03, .read_dummy = 0, .op_prog = 0x02,                      \
+    .op_erase4k = 0x20, .op_erase32k = 0x52, .op_erase64k = 0xD8,           \
+    .addr_bytes = 3, .page_size = FLASH_PAGE_SIZE, .prog_path = PROG_PAGE,  \
+    .sus_ok = true, .op_esus = 0x75, .op_eres = 0x7A,                       \
+    .op_psus = 0x75, .op_pres = 0x7A,                                       \
+    .esus_us = 30u, .psus_us = 30u, .egap_us = 100u, .pgap_us = 100u,       \
+    .read_mode = FLASH_READ_1_1_1,                                          \
+    .wait = {                                                               \
+        [FLASH_WAIT_PROG]     = { 0, 0, TOUT_PROG_US,  0 },                 \
+        [FLASH_WAIT_ERASE_4K] = { 0, 0, TOUT_ERASE_US, 0 },                 \
+        [FLASH_WAIT_ERASE_32K]= { 0, 0, TOUT_ERASE32_US, 0 },               \
+        [FLASH_WAIT_ERASE_64K]= { 0, 0, TOUT_ERASE64_US, 0 },               \
+        [FLASH_WAIT_CHIP]     = { 0, 0, TOUT_CHIP_US,  0 },                 \
+        [FLASH_WAIT_OTHER]    = { 0, 0, TOUT_ERASE_US, 0 },                 \
+    },                                                                      \
+}
+
+// Slot 0 is the default wiring and usable before flash_init_spi().
+static flash_dev_t  s_devs[FLASH_MAX_DEVS] = { FLASH_DEV_INIT(spi0, PIN_CS) };
+static unsigned     s_ndevs = 0;
+static flash_dev_t *s_cur   = &s_devs[0];
+
+// ---- Non-blocking operation (flash_op_*) ----
+typedef enum { OP_STEP_WREN, OP_STEP_CMD, OP_STEP_WIP } op_step_t;
+
+static struct {
+    volatile flash_op_state_t state;
+    op_step_t         step;
+    flash_wait_kind_t kind;
+    uint32_t          addr;
+    const uint8_t    *data;
+    uint32_t          len;
+    uint8_t           wren_tries;
+    absolute_time_t   t_cmd;
+    absolute_time_t   t_suspend;         // when suspended; t_cmd is pushed out by the gap
+    absolute_time_t   t_next_suspend;    // resume-to-suspend gap
+    uint32_t          elapsed_us;
+    flash_op_cb_t     cb;
+    void             *ctx;
+} s_fop = { .state = FLASH_OP_IDLE };
+
+static volatile bool   s_async_busy = false;
+static flash_read_cb_t s_async_cb   = NULL;
+static void           *s_async_ctx  = NULL;
+
+// Starting a new transaction always waits for an in-flight async read,
+// so nothing else can drive the bus while DMA owns CS.
+void cs_low(void)  { flash_read_wait(); gpio_put(s_cur->cs_pin, 0); }
+void cs_high(void) { gpio_put(s_cur->cs_pin, 1); }
+
+static void __not_in_flash_func(flash_dma_irq_handler)(void) {
+    if (s_dma_rx < 0 || !(dma_hw->ints1 & (1u << s_dma_rx))) return;
+    dma_hw->ints1 = 1u << s_dma_rx;              // clear it
+    dma_channel_set_irq1_enabled((uint)s_dma_rx, false);
+    cs_high();
+    s_async_busy = false;
+    if (s_async_cb) s_async_cb(s_async_ctx);
+}
+
+static bool flash_dma_init(void) {
+    if (s_dma_rx >= 0) return true;
+
+    int tx = dma_claim_unused_channel(false);
+    int rx = dma_claim_unused_channel(false);
+    if (tx < 0 || rx < 0) {
+        if (tx >= 0) dma_channel_unclaim((uint)tx);
+        if (rx >= 0) dma_channel_unclaim((uint)rx);
+        printf("WARNING: no free DMA channels, flash reads stay CPU-driven\r\n");
+        return false;
+    }
+
+    // TX: fixed dummy byte -> SPI DR, paced by TX DREQ
+    s_dma_tx_cfg = dma_channel_get_default_config((uint)tx);
+    channel_config_set_transfer_data_size(&s_dma_tx_cfg, DMA_SIZE_8);
+    channel_config_set_dreq(&s_dma_tx_cfg, spi_get_dreq(s_cur->spi, true));
+    channel_config_set_read_increment(&s_dma_tx_cfg, false);
+    channel_config_set_write_increment(&s_dma_tx_cfg, false);
+
+    // RX: SPI DR -> buffer, paced by RX DREQ
+    s_dma_rx_cfg = dma_channel_get_default_config((uint)rx);
+    channel_config_set_transfer_data_size(&s_dma_rx_cfg, DMA_SIZE_8);
+    channel_config_set_dreq(&s_dma_rx_cfg, spi_get_dreq(s_cur->spi, false));
+    channel_config_set_read_increment(&s_dma_rx_cfg, false);
+    channel_config_set_write_increment(&s_dma_rx_cfg, true);
+
+    irq_add_shared_handler(DMA_IRQ_1, flash_dma_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    s_dma_tx = tx;
+    s_dma_rx = rx;
+    return true;
+}
+
+// Clock 'len' bytes from the flash into 'buf' by DMA. CS must already be low
+// and the command header sent. Returns once both channels are running.
+static void flash_dma_start_rx(uint8_t *buf, uint32_t len, bool irq) {
+    static const uint8_t dummy_tx = 0x00;
+
+    dma_hw->ints1 = 1u << s_dma_rx;              // drop any stale completion
+    dma_channel_set_irq1_enabled((uint)s_dma_rx, irq);
+
+    dma_channel_configure((uint)s_dma_tx, &s_dma_tx_cfg,
+                          &spi_get_hw(s_cur->spi)->dr, &dummy_tx, len, false);
+    dma_channel_configure((uint)s_dma_rx, &s_dma_rx_cfg,
+                          buf, &spi_get_hw(s_cur->spi)->dr, len, false);
+
+    // start both together so the RX FIFO can never overflow
+    dma_start_channel_mask((1u << s_dma_tx) | (1u << s_dma_rx));
+}
+
+// Clock 'len' bytes from 'buf' out to the flash by DMA. RX drains into a
+// dummy byte so the FIFO can't overrun, and finishing RX means the last
+// byte is on the wire. CS must already be low and the header sent.
+static void flash_dma_start_tx(const uint8_t *buf, uint32_t len) {
+    static uint8_t dummy_rx;
+    dma_channel_config tx = s_dma_tx_cfg, rx = s_dma_rx_cfg;
+    channel_config_set_read_increment(&tx, true);
+    channel_config_set_write_increment(&rx, false);
+
+    dma_hw->ints1 = 1u << s_dma_rx;
+    dma_channel_set_irq1_enabled((uint)s_dma_rx, false);
+
+    dma_channel_configure((uint)s_dma_tx, &tx, &spi_get_hw(s_cur->spi)->dr, buf, len, false);
+    dma_channel_configure((uint)s_dma_rx, &rx, &dummy_rx, &spi_get_hw(s_cur->spi)->dr, len, false);
+    dma_start_channel_mask((1u << s_dma_tx) | (1u << s_dma_rx));
+}
+
+// Opcode + 3- or 4-byte address; returns header length.
+static uint32_t cmd_hdr(uint8_t *hdr, uint8_t op, uint32_t addr) {
+    uint32_t n = 0;
+    hdr[n++] = op;
+    if (s_cur->addr_bytes == 4) hdr[n++] = (uint8_t)(addr>>24);
+    hdr[n++] = (uint8_t)(addr>>16);
+    hdr[n++] = (uint8_t)(addr>>8);
+    hdr[n++] = (uint8_t)addr;
+    return n;
+}
+
+// Read header: opcode, address, then the dummy byte(s) Fast Read needs.
+static uint32_t read_hdr(uint8_t *hdr, uint32_t addr) {
+    uint32_t n = cmd_hdr(hdr, s_cur->op_read, addr);
+    for (uint8_t i = 0; i < s_cur->read_dummy; i++) hdr[n++] = 0x00;
+    return n;
+}
+
+// Most vendors put log2(bytes) in the third JEDEC byte; Winbond/Micron jump
+// to 0x20 for 512 Mbit, SST26 uses its own low-nibble code and SST25 a
+// per-part device byte.
+static uint32_t jedec_capacity(const uint8_t id[3]) {
+    uint8_t c = id[2];
+    if (id[0] == 0xBF && id[1] == 0x26) return (1024u * 1024u) << (c & 0x0F);
+    if (id[0] == 0xBF && id[1] == 0x25) {
+        switch (c) {
+        case 0x8D: return 512u * 1024u;          // SST25VF040B
+        case 0x8E: return 1024u * 1024u;         // SST25VF080B
+        case 0x41: return 2u * 1024u * 1024u;    // SST25VF016B
+        case 0x4A: return 4u * 1024u * 1024u;    // SST25VF032B
+        case 0x4B: return 8u * 1024u * 1024u;    // SST25VF064C
+        default:   return 0;
+        }
+    }
+    if (c >= 0x10 && c <= 0x1F) return 1u << c;
+    if (c >= 0x20 && c <= 0x22) return (64u * 1024u * 1024u) << (c - 0x20);
+    return 0;
+}
 
 static FRESULT ensure_sd_and_folder(void) {
     FRESULT fr = f_mount(&g_fs, "0:", 1);
@@ -25,62 +297,1033 @@ static FRESULT ensure_sd_and_folder(void) {
 }
 
 void flash_init_spi(uint32_t hz){
+    static const uint cs_pins[] = FLASH_CS_PINS;
+
     spi_init(spi0, hz);
     spi_set_format(spi0, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
     gpio_set_function(PIN_SCK,  GPIO_FUNC_SPI);
     gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
     gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
-    gpio_init(PIN_CS);
-    gpio_set_dir(PIN_CS, GPIO_OUT);
+
+    // every CS goes high before any chip is talked to
+    for (size_t i = 0; i < sizeof cs_pins / sizeof cs_pins[0]; i++)
+        flash_dev_add(spi0, cs_pins[i]);
+    for (unsigned i = 0; i < s_ndevs; i++)
+        if (s_devs[i].spi == spi0) s_devs[i].hz = hz;
+    s_cur = &s_devs[0];
     cs_high();
+    flash_dma_init();
+}
+
+uint32_t flash_set_clock(uint32_t hz){
+    uint32_t actual = spi_set_baudrate(s_cur->spi, hz);
+    s_cur->hz = hz;
+    cs_high();
+    return actual;
+}
+
+uint32_t flash_get_clock(void){
+    return s_cur->hz;
+}
+
+// ---- Devices ----
+flash_dev_t *flash_dev_add(spi_inst_t *spi, uint cs_pin){
+    for (unsigned i = 0; i < s_ndevs; i++)
+        if (s_devs[i].spi == spi && s_devs[i].cs_pin == cs_pin) return &s_devs[i];
+    if (s_ndevs >= FLASH_MAX_DEVS) return NULL;
+
+    flash_dev_t *d = &s_devs[s_ndevs++];
+    *d = (flash_dev_t)FLASH_DEV_INIT(spi, cs_pin);
+    gpio_init(cs_pin);
+    gpio_put(cs_pin, 1);
+    gpio_set_dir(cs_pin, GPIO_OUT);
+    return d;
+}
+
+unsigned flash_dev_count(void) { return s_ndevs; }
+
+flash_dev_t *flash_dev_get(unsigned idx){
+    return idx < s_ndevs ? &s_devs[idx] : NULL;
+}
+
+bool flash_dev_select(flash_dev_t *dev){
+    if (!dev) return false;
+    if (dev == s_cur) return true;
+    if (s_fop.state == FLASH_OP_BUSY || s_fop.state == FLASH_OP_SUSPENDED) return false;
+    flash_read_wait();
+    if (dev->spi != s_cur->spi && s_dma_rx >= 0) {
+        channel_config_set_dreq(&s_dma_tx_cfg, spi_get_dreq(dev->spi, true));
+        channel_config_set_dreq(&s_dma_rx_cfg, spi_get_dreq(dev->spi, false));
+    }
+    s_cur = dev;
+    spi_set_baudrate(dev->spi, dev->hz);
+    return true;
+}
+
+flash_dev_t *flash_dev_current(void) { return s_cur; }
+uint flash_dev_cs_pin(const flash_dev_t *dev) { return dev ? dev->cs_pin : s_cur->cs_pin; }
+spi_inst_t *flash_spi(void) { return s_cur->spi; }
+
+void flash_enter_4byte_mode(void){
+    write_enable();                  // Micron wants WREN first; harmless elsewhere
+    uint8_t cmd = 0xB7;
+    cs_low(); spi_write_blocking(s_cur->spi, &cmd, 1); cs_high();
+    s_cur->addr_bytes = 4;
+    s_cur->en4b = true;
+}
+
+static void use_4byte_opcodes(void){
+    s_cur->addr_bytes = 4; s_cur->op4b = true;
+    s_cur->op_read = 0x0C; s_cur->op_prog = 0x12; s_cur->op_erase4k = 0x21;
+    s_cur->op_erase32k = 0x5C; s_cur->op_erase64k = 0xDC;
+}
+
+// Seed a wait profile unless spichips.csv, SFDP or an earlier probe
+// already did; reseeding would also throw away the learned estimate.
+static void seed_timing(flash_wait_kind_t kind, uint32_t typ_us, uint32_t max_us){
+    if (typ_us && !s_cur->wait[kind].typ_us) flash_set_timing(kind, typ_us, max_us);
+}
+
+// Apply the SFDP profile on top of the Fast Read defaults: density, page
+// size, address mode, the erase sizes the part really has (with their
+// 4BAIT opcodes) and typical/max busy times.
+static void sfdp_configure(void){
+    const sfdp_info_t *p = &s_cur->sfdp;
+    if (p->density_bytes) s_cur->capacity = p->density_bytes;
+    if (p->page_size >= 16u && p->page_size <= FLASH_ERASE_SIZE) s_cur->page_size = p->page_size;
+
+    bool need4 = p->addr_mode == SFDP_ADDR_4 || s_cur->capacity > (16u * 1024u * 1024u);
+    if (need4 && p->addr_mode != SFDP_ADDR_3) {
+        // 4BAIT bit 1: 0x0C fast read, bit 6: 0x12 page program
+        if (p->has_4bait && (p->bait_support & 0x42u) == 0x42u) use_4byte_opcodes();
+        else if (p->addr_mode == SFDP_ADDR_4) s_cur->addr_bytes = 4;   // always 4-byte, plain opcodes
+        else flash_enter_4byte_mode();
+    }
+
+    // Erase types the part lists; with 4-byte opcodes but no 4BAIT, assume
+    // the usual 0x21/0x5C/0xDC. 4K sectors are assumed by everything here,
+    // so that size keeps its default opcode if the table leaves it out.
+    static const uint32_t sizes[3] = { 4096u, 32u * 1024u, 64u * 1024u };
+    static const uint8_t  op4b[3]  = { 0x21, 0x5C, 0xDC };
+    static const flash_wait_kind_t kinds[3] = {
+        FLASH_WAIT_ERASE_4K, FLASH_WAIT_ERASE_32K, FLASH_WAIT_ERASE_64K
+    };
+    uint8_t ops[3] = { 0, 0, 0 };
+    for (int t = 0; t < 4; t++) {
+        const sfdp_erase_t *e = &p->erase[t];
+        for (int k = 0; k < 3; k++) {
+            if (e->size != sizes[k] || ops[k]) continue;
+            if (!s_cur->op4b)        ops[k] = e->opcode;
+            else if (p->has_4bait)   ops[k] = e->opcode_4b;
+            else                     ops[k] = op4b[k];
+            seed_timing(kinds[k], e->typ_us, e->max_us);
+        }
+    }
+    if (ops[0]) s_cur->op_erase4k = ops[0];
+    s_cur->op_erase32k = ops[1];
+    s_cur->op_erase64k = ops[2];
+
+    seed_timing(FLASH_WAIT_PROG, p->prog_typ_us, p->prog_max_us);
+    seed_timing(FLASH_WAIT_CHIP, p->chip_typ_us, p->chip_max_us);
+
+    if (p->bfpt_dwords >= 13u) {
+        s_cur->sus_ok = p->has_suspend;
+        if (s_cur->sus_ok) {
+            s_cur->op_esus = p->erase_suspend_op; s_cur->op_eres = p->erase_resume_op;
+            s_cur->op_psus = p->prog_suspend_op;  s_cur->op_pres = p->prog_resume_op;
+            s_cur->esus_us = p->erase_suspend_us; s_cur->psus_us = p->prog_suspend_us;
+            s_cur->egap_us = p->erase_resume_gap_us; s_cur->pgap_us = p->prog_resume_gap_us;
+        }
+    }
+}
+
+// SST parts power up write-protected: SST26 wants a global block-protection
+// unlock (ULBPR 0x98), SST25 its BP bits in SR1 cleared (EWSR 0x50 + WRSR).
+static void sst_unlock(void){
+    if (s_cur->sst_type == 0x26) {
+        write_enable();
+        uint8_t cmd = 0x98;
+        cs_low(); spi_write_blocking(s_cur->spi, &cmd, 1); cs_high();
+    } else {
+        uint8_t ewsr = 0x50, wrsr[2] = { 0x01, 0x00 };
+        cs_low(); spi_write_blocking(s_cur->spi, &ewsr, 1); cs_high();
+        cs_low(); spi_write_blocking(s_cur->spi, wrsr, 2); cs_high();
+        wait_wip_clear();
+    }
+}
+
+// SST25 has no page program, only byte and AAI word program; SST26 pages
+// normally, but its 0xD8 erases 8K, 32K or 64K depending on where in the
+// array it lands, so the planner sticks to 4K sectors and chip erase.
+// Timing defaults are the datasheet typ/max (SST25VF016B, SST26VF016B).
+static void sst_configure(const uint8_t id[3]){
+    s_cur->sst_type = id[1];
+    if (s_cur->sst_type == 0x26) {
+        s_cur->op_erase32k = 0;
+        s_cur->op_erase64k = 0;
+        seed_timing(FLASH_WAIT_PROG, 1000u, 1500u);
+    } else {
+        s_cur->prog_path = PROG_AAI;
+        seed_timing(FLASH_WAIT_ERASE_32K, 18000u, 25000u);
+        seed_timing(FLASH_WAIT_ERASE_64K, 18000u, 25000u);
+    }
+    seed_timing(FLASH_WAIT_ERASE_4K, 18000u, 25000u);
+    seed_timing(FLASH_WAIT_CHIP, 35000u, 50000u);
+    sst_unlock();
+}
+
+// Suspend defaults by vendor, before SFDP gets a say
+static void suspend_defaults(const uint8_t id[3]){
+    s_cur->sus_ok = true;
+    s_cur->op_esus = s_cur->op_psus = 0x75;
+    s_cur->op_eres = s_cur->op_pres = 0x7A;
+    s_cur->esus_us = s_cur->psus_us = 30u;
+    s_cur->egap_us = s_cur->pgap_us = 100u;
+    s_cur->sus_erase_sr2 = s_cur->sus_prog_sr2 = 0;
+    switch (id[0]) {
+    case 0xEF: s_cur->sus_erase_sr2 = 0x80; s_cur->sus_prog_sr2 = 0x80; break; // Winbond
+    case 0xC8: s_cur->sus_erase_sr2 = 0x80; s_cur->sus_prog_sr2 = 0x04; break; // GigaDevice
+    case 0xC2: s_cur->op_esus = s_cur->op_psus = 0xB0;                         // Macronix
+               s_cur->op_eres = s_cur->op_pres = 0x30; break;
+    case 0xBF: s_cur->op_esus = s_cur->op_psus = 0xB0;                         // SST26; SST25 has none
+               s_cur->op_eres = s_cur->op_pres = 0x30;
+               s_cur->sus_ok = (id[1] == 0x26); break;
+    default: break;
+    }
+}
+
+uint32_t flash_probe(void){
+    uint8_t id[3] = {0};
+    read_jedec_id(id);
+
+    // back to the legacy set until we know better
+    s_cur->op_read = 0x03; s_cur->read_dummy = 0;
+    s_cur->op_prog = 0x02; s_cur->op_erase4k = 0x20;
+    s_cur->op_erase32k = 0x52; s_cur->op_erase64k = 0xD8;
+    s_cur->addr_bytes = 3; s_cur->en4b = false; s_cur->op4b = false;
+    s_cur->capacity = 0;
+    s_cur->page_size = FLASH_PAGE_SIZE;
+    s_cur->prog_path = PROG_PAGE; s_cur->sst_type = 0;
+    s_cur->has_sfdp = false;
+    s_cur->read_mode = FLASH_READ_1_1_1;
+    suspend_defaults(id);
+
+    if ((id[0] == 0x00 && id[1] == 0x00 && id[2] == 0x00) ||
+        (id[0] == 0xFF && id[1] == 0xFF && id[2] == 0xFF)) {
+        return 0;                    // nothing answering
+    }
+
+    // Fast Read has no clock ceiling below the part's max; 0x03 tops out ~50 MHz
+    s_cur->op_read = 0x0B; s_cur->read_dummy = 1;
+    s_cur->capacity = jedec_capacity(id);
+
+    // 0x5A is only specified to 50 MHz, so read the tables at the safe clock
+    uint32_t hz = spi_get_baudrate(s_cur->spi);
+    if (hz > SAFE_PROG_HZ) flash_set_clock(SAFE_PROG_HZ);
+    s_cur->has_sfdp = sfdp_parse(&s_cur->sfdp);
+    if (hz > SAFE_PROG_HZ) flash_set_clock(hz);
+
+    if (s_cur->has_sfdp) {
+        sfdp_configure();
+    } else if (s_cur->capacity > (16u * 1024u * 1024u)) {
+        if (id[0] == 0x20) {
+            // older Micron N25Q parts lack the dedicated 4-byte opcodes
+            flash_enter_4byte_mode();
+        } else {
+            use_4byte_opcodes();
+        }
+    }
+    if (id[0] == 0xBF) sst_configure(id);
+    return s_cur->capacity;
+}
+
+uint32_t flash_capacity_bytes(void){
+    return s_cur->capacity ? s_cur->capacity : FLASH_TOTAL_BYTES;
+}
+
+uint8_t flash_addr_bytes(void) { return s_cur->addr_bytes; }
+bool flash_uses_4byte_opcodes(void) { return s_cur->op4b; }
+
+const sfdp_info_t *flash_sfdp(void) { return s_cur->has_sfdp ? &s_cur->sfdp : NULL; }
+uint32_t flash_page_size(void) { return s_cur->page_size; }
+
+bool flash_erase_supported(uint32_t size){
+    if (size == 32u * 1024u) return s_cur->op_erase32k != 0;
+    if (size == 64u * 1024u) return s_cur->op_erase64k != 0;
+    return size == 4096u || (s_cur->capacity && size == s_cur->capacity);
+}
+
+static const sfdp_read_t *sfdp_read_params(flash_read_mode_t mode){
+    switch (mode) {
+    case FLASH_READ_1_1_2: return &s_cur->sfdp.read_112;
+    case FLASH_READ_1_1_4: return &s_cur->sfdp.read_114;
+    case FLASH_READ_1_4_4: return &s_cur->sfdp.read_144;
+    default:               return NULL;
+    }
+}
+
+uint8_t flash_read_wait_clocks(flash_read_mode_t mode){
+    const sfdp_read_t *r = s_cur->has_sfdp ? sfdp_read_params(mode) : NULL;
+    if (r && r->supported) return (uint8_t)(r->mode_clocks + r->dummy_clocks);
+    return mode == FLASH_READ_1_4_4 ? (uint8_t)(2u + QIO_DUMMY_CLOCKS) : 8u;
+}
+
+// With SFDP, a multi-lane read must be listed, and the 1-1-x ones must want
+// the single dummy byte (8 clocks) the SPI sends for them.
+static bool read_mode_legal(flash_read_mode_t mode){
+    const sfdp_read_t *r = s_cur->has_sfdp ? sfdp_read_params(mode) : NULL;
+    if (!r) return true;
+    if (!r->supported) return false;
+    if (mode == FLASH_READ_1_4_4) return r->mode_clocks + r->dummy_clocks >= 3u;
+    return r->mode_clocks + r->dummy_clocks == 8u;
+}
+
+bool flash_set_read_mode(flash_read_mode_t mode){
+    if (mode >= FLASH_READ_MODES) return false;
+    if (!read_mode_legal(mode)) return false;
+    if (!flash_qspi_prepare(mode)) return false;
+    s_cur->read_mode = mode;
+    return true;
+}
+
+flash_read_mode_t flash_get_read_mode(void) { return s_cur->read_mode; }
+
+const char *flash_read_mode_name(flash_read_mode_t mode){
+    static const char *const names[FLASH_READ_MODES] = { "1-1-1", "1-1-2", "1-1-4", "1-4-4" };
+    return mode < FLASH_READ_MODES ? names[mode] : "?";
 }
 
 void read_jedec_id(uint8_t id[3]){
     uint8_t tx[4] = {0x9F, 0, 0, 0}, rx[4] = {0};
-    cs_low(); spi_write_read_blocking(spi0, tx, rx, 4); cs_high();
+    cs_low(); spi_write_read_blocking(s_cur->spi, tx, rx, 4); cs_high();
     id[0]=rx[1]; id[1]=rx[2]; id[2]=rx[3];
 }
 
 uint8_t read_status(uint8_t which){
     uint8_t tx[2] = {which, 0}, rx[2] = {0};
-    cs_low(); spi_write_read_blocking(spi0, tx, rx, 2); cs_high();
+    cs_low(); spi_write_read_blocking(s_cur->spi, tx, rx, 2); cs_high();
     return rx[1];
 }
 
 bool read_sfdp_header(uint8_t hdr8[8]){
-    uint8_t cmd[5] = {0x5A,0,0,0,0};
-    cs_low(); spi_write_blocking(spi0, cmd, 5);
-    spi_read_blocking(spi0, 0x00, hdr8, 8); cs_high();
+    sfdp_read(0, hdr8, 8);
     return hdr8[0]==0x53 && hdr8[1]==0x46 && hdr8[2]==0x44 && hdr8[3]==0x50;
 }
 
 void write_enable(void){
-    uint8_t cmd=0x06; cs_low(); spi_write_blocking(spi0,&cmd,1); cs_high();
+    uint8_t cmd=0x06; cs_low(); spi_write_blocking(s_cur->spi,&cmd,1); cs_high();
+}
+
+void flash_set_timing(flash_wait_kind_t kind, uint32_t typ_us, uint32_t max_us){
+    if (kind >= FLASH_WAIT_KINDS) return;
+    s_cur->wait[kind].typ_us = typ_us;
+    s_cur->wait[kind].max_us = max_us;
+    s_cur->wait[kind].est_us = typ_us;
+}
+
+uint32_t flash_last_busy_us(void) { return s_last_busy_us; }
+
+static uint32_t wait_timeout_us(flash_wait_kind_t kind){
+    const wait_profile_t *w = &s_cur->wait[kind];
+    return w->max_us > w->tout_us ? w->max_us : w->tout_us;
+}
+
+// EWMA, 1/8 weight: follows the part without chasing outliers
+static void wait_learn(flash_wait_kind_t kind, uint32_t el){
+    s_last_busy_us = el;
+    if (kind == FLASH_WAIT_OTHER) return;
+    wait_profile_t *w = &s_cur->wait[kind];
+    w->est_us = w->est_us ? (uint32_t)((int32_t)w->est_us + ((int32_t)el - (int32_t)w->est_us) / 8) : el;
+}
+
+static void wait_us(uint32_t us, bool may_sleep){
+    if (!us) return;
+    if (may_sleep) sleep_us(us);
+    else busy_wait_us_32(us);
+}
+
+// As flash_wait_ready(), with the busy time counted from t0 (when the
+// command went out) rather than from the call.
+static bool wait_ready_from(flash_wait_kind_t kind, absolute_time_t t0, bool may_sleep){
+    if (kind >= FLASH_WAIT_KINDS) kind = FLASH_WAIT_OTHER;
+    wait_profile_t *w = &s_cur->wait[kind];
+    uint32_t tout = wait_timeout_us(kind);
+    uint32_t est  = w->est_us;
+    uint32_t cap  = (w->max_us > est ? w->max_us : est) / 32u;
+    if (cap < 1u) cap = 1u;
+    if (cap > FLASH_POLL_MAX_STEP_US) cap = FLASH_POLL_MAX_STEP_US;
+
+    uint32_t gone = (uint32_t)absolute_time_diff_us(t0, get_absolute_time());
+    if (gone < est / 2u) wait_us(est / 2u - gone, may_sleep);   // nothing to see yet
+
+    uint8_t cmd = 0x05, sr = 0;
+    uint32_t step = 0;
+    cs_low(); spi_write_blocking(s_cur->spi, &cmd, 1);
+    for (;;) {
+        spi_read_blocking(s_cur->spi, 0x00, &sr, 1);  // SR1 repeats for as long as CS is low
+        uint32_t el = (uint32_t)absolute_time_diff_us(t0, get_absolute_time());
+        if (!(sr & 0x01)) {
+            cs_high();
+            flash_phase_mark(FLASH_PH_WIP);
+            wait_learn(kind, el);
+            return true;
+        }
+        if (el > tout) {
+            cs_high();
+            flash_phase_mark(FLASH_PH_WIP);
+            printf("flash: %s still busy after %u us (SR1=%02X)\r\n",
+                   s_wait_name[kind], (unsigned)el, sr);
+            return false;
+        }
+        // back-to-back until the estimate, then exponential back-off up to cap
+        if (el >= est) {
+            step = step ? step * 2u : 1u;
+            if (step > cap) step = cap;
+        }
+        wait_us(step, may_sleep);
+    }
 }
 
-void wait_wip_clear(void){
-    while (read_status(0x05) & 1) { sleep_ms(1); }
+bool flash_wait_ready(flash_wait_kind_t kind, bool may_sleep){
+    return wait_ready_from(kind, get_absolute_time(), may_sleep);
+}
+
+bool wait_wip_clear(void){
+    return flash_wait_ready(FLASH_WAIT_OTHER, true);
 }
 
 void read_data(uint32_t addr, uint8_t *buf, uint32_t len){
-    uint8_t hdr[4] = {0x03, (uint8_t)(addr>>16),(uint8_t)(addr>>8),(uint8_t)addr};
-    cs_low(); spi_write_blocking(spi0, hdr, 4);
-    spi_read_blocking(spi0, 0x00, buf, (int)len); cs_high();
+    if (s_cur->read_mode != FLASH_READ_1_1_1) {
+        flash_qspi_read(s_cur->read_mode, addr, buf, len);   // one phase: the PIO owns the framing
+        flash_phase_mark(FLASH_PH_DATA);
+        return;
+    }
+    uint8_t hdr[6];
+    uint32_t n = read_hdr(hdr, addr);
+    cs_low(); spi_write_blocking(s_cur->spi, hdr, n);
+    flash_phase_mark(FLASH_PH_CMD);
+    if (len >= FLASH_DMA_MIN_BYTES && flash_dma_init()) {
+        flash_dma_start_rx(buf, len, false);
+        dma_channel_wait_for_finish_blocking((uint)s_dma_rx);
+    } else {
+        spi_read_blocking(s_cur->spi, 0x00, buf, (int)len);
+    }
+    cs_high();
+    flash_phase_mark(FLASH_PH_DATA);
+}
+
+void read_data_async(uint32_t addr, uint8_t *buf, uint32_t len,
+                     flash_read_cb_t done, void *ctx){
+    if (len < FLASH_DMA_MIN_BYTES || s_cur->read_mode != FLASH_READ_1_1_1 || !flash_dma_init()) {
+        // too small, PIO backend, or no DMA: just do it now and report completion
+        read_data(addr, buf, len);
+        if (done) done(ctx);
+        return;
+    }
+    uint8_t hdr[6];
+    uint32_t n = read_hdr(hdr, addr);
+    cs_low(); spi_write_blocking(s_cur->spi, hdr, n);
+    s_async_cb   = done;
+    s_async_ctx  = ctx;
+    s_async_busy = true;
+    flash_dma_start_rx(buf, len, true);          // IRQ releases CS
+}
+
+bool flash_read_busy(void) { return s_async_busy; }
+
+void flash_read_wait(void) {
+    while (s_async_busy) { tight_loop_contents(); }
+}
+
+// ---- Phase timing ----
+// SysTick runs free on clk_sys: exact cycles, but only 24 bits of them
+// (~134 ms at 125 MHz). The 1 us timer read next to it is only good to a
+// few hundred cycles, which is plenty to say how many wraps went by.
+#define SYSTICK_MASK 0x00FFFFFFu
+
+static struct {
+    bool     on;
+    uint32_t cvr;           // SysTick at the last mark (counts down)
+    uint64_t us;            // timer at the last mark
+    flash_phase_log_t log;
+} s_ph;
+
+static const char *const s_phase_name[FLASH_PHASES] = {
+    "wren", "cmd", "data", "wip", "status"
+};
+
+void flash_phase_begin(void){
+    if (!(systick_hw->csr & 1u) || systick_hw->rvr != SYSTICK_MASK) {
+        systick_hw->csr = 0;
+        systick_hw->rvr = SYSTICK_MASK;
+        systick_hw->cvr = 0;
+        systick_hw->csr = 0x5u;             // ENABLE, CLKSOURCE = processor clock
+    }
+    memset(&s_ph.log, 0, sizeof s_ph.log);
+    s_ph.log.sys_mhz = clock_get_hz(clk_sys) / 1000000u;
+    s_ph.cvr = systick_hw->cvr;
+    s_ph.us  = time_us_64();
+    s_ph.on  = true;
+}
+
+void flash_phase_mark(flash_phase_t ph){
+    if (!s_ph.on || ph >= FLASH_PHASES) return;
+    uint32_t cvr = systick_hw->cvr;
+    uint64_t us  = time_us_64();
+    uint32_t cyc = (s_ph.cvr - cvr) & SYSTICK_MASK;
+    uint64_t want = (us - s_ph.us) * s_ph.log.sys_mhz;
+    if (want > cyc)     // add the whole wraps nearest the timer's figure
+        cyc += (uint32_t)(((want - cyc + (SYSTICK_MASK + 1u) / 2u) / (SYSTICK_MASK + 1u)) * (SYSTICK_MASK + 1u));
+    s_ph.log.cycles[ph] += cyc;
+    s_ph.cvr = cvr;
+    s_ph.us  = us;
+}
+
+void flash_phase_end(flash_phase_log_t *log){
+    s_ph.on = false;
+    if (log) *log = s_ph.log;
+}
+
+const char *flash_phase_name(flash_phase_t ph){
+    return ph < FLASH_PHASES ? s_phase_name[ph] : "?";
+}
+
+// ---- CRC32 verify ----
+// The DMA sniffer checksums bytes as a channel moves them, so a region is
+// verified by streaming it off the bus into a single dummy byte and
+// comparing against the sniffed CRC of the expected data (a DMA pass over
+// memory). No read-back buffer, no CPU compare. Without DMA, or on a PIO
+// read mode, the same CRC is worked out in software.
+uint32_t flash_crc32_sw(uint32_t crc, const uint8_t *p, uint32_t len) {
+    while (len--) {
+        crc ^= (uint32_t)*p++ << 24;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80000000u) ? (crc << 1) ^ 0x04C11DB7u : (crc << 1);
+    }
+    return crc;
+}
+
+static void sniff_begin(uint ch, uint32_t seed) {
+    dma_sniffer_enable(ch, FLASH_SNIFF_CRC32, true);
+    dma_hw->sniff_data = seed;
+}
+
+static uint32_t sniff_end(void) {
+    uint32_t crc = dma_hw->sniff_data;
+    dma_sniffer_disable();
+    return crc;
+}
+
+// Own channel, so it can run while an async flash read is in flight
+// (the pipelined backup checksums one buffer while the next streams in).
+// No final XOR, so seeding with an earlier result continues that CRC.
+static uint32_t crc32_buf_from(uint32_t seed, const uint8_t *p, uint32_t len){
+    if (len >= FLASH_DMA_MIN_BYTES && s_dma_crc < 0) s_dma_crc = dma_claim_unused_channel(false);
+    if (len < FLASH_DMA_MIN_BYTES || s_dma_crc < 0) return flash_crc32_sw(seed, p, len);
+    static uint8_t sink;
+    dma_channel_config c = dma_channel_get_default_config((uint)s_dma_crc);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);     // memory pace
+    channel_config_set_sniff_enable(&c, true);
+    sniff_begin((uint)s_dma_crc, seed);
+    dma_channel_configure((uint)s_dma_crc, &c, &sink, p, len, true);
+    dma_channel_wait_for_finish_blocking((uint)s_dma_crc);
+    return sniff_end();
+}
+
+uint32_t flash_crc32_buf(const uint8_t *p, uint32_t len){
+    return crc32_buf_from(FLASH_CRC32_SEED, p, len);
+}
+
+// Flash -> one sink byte by DMA; CS low and the header sent
+static void dma_read_to_sink(uint32_t len, bool sniff){
+    static const uint8_t dummy_tx = 0x00;
+    static uint8_t sink;
+    dma_channel_config rx = s_dma_rx_cfg;
+    channel_config_set_write_increment(&rx, false);
+    channel_config_set_sniff_enable(&rx, sniff);
+    dma_hw->ints1 = 1u << s_dma_rx;
+    dma_channel_set_irq1_enabled((uint)s_dma_rx, false);
+    if (sniff) sniff_begin((uint)s_dma_rx, FLASH_CRC32_SEED);
+    dma_channel_configure((uint)s_dma_tx, &s_dma_tx_cfg,
+                          &spi_get_hw(s_cur->spi)->dr, &dummy_tx, len, false);
+    dma_channel_configure((uint)s_dma_rx, &rx, &sink, &spi_get_hw(s_cur->spi)->dr, len, false);
+    dma_start_channel_mask((1u << s_dma_tx) | (1u << s_dma_rx));
+    dma_channel_wait_for_finish_blocking((uint)s_dma_rx);
+}
+
+bool flash_read_discard(uint32_t addr, uint32_t len){
+    if (s_cur->read_mode != FLASH_READ_1_1_1) return false;
+    uint8_t hdr[6];
+    uint32_t n = read_hdr(hdr, addr);
+    cs_low(); spi_write_blocking(s_cur->spi, hdr, n);
+    if (flash_dma_init()) {
+        dma_read_to_sink(len, false);            // every size, so small reads time the same path
+    } else {
+        uint8_t tmp[256];
+        for (uint32_t off = 0; off < len; off += sizeof tmp)
+            spi_read_blocking(s_cur->spi, 0x00, tmp, (int)((len - off > sizeof tmp) ? sizeof tmp : (len - off)));
+    }
+    cs_high();
+    return true;
+}
+
+uint32_t flash_crc32(uint32_t addr, uint32_t len){
+    if (len < FLASH_DMA_MIN_BYTES || s_cur->read_mode != FLASH_READ_1_1_1 || !flash_dma_init()) {
+        uint8_t tmp[256];
+        uint32_t crc = FLASH_CRC32_SEED;
+        for (uint32_t off = 0; off < len; off += sizeof tmp) {
+            uint32_t n = (len - off > sizeof tmp) ? sizeof tmp : (len - off);
+            read_data(addr + off, tmp, n);
+            crc = flash_crc32_sw(crc, tmp, n);
+        }
+        return crc;
+    }
+    uint8_t hdr[6];
+    uint32_t n = read_hdr(hdr, addr);
+    cs_low(); spi_write_blocking(s_cur->spi, hdr, n);
+    dma_read_to_sink(len, true);
+    cs_high();
+    return sniff_end();
+}
+
+uint32_t flash_verify(uint32_t addr, const uint8_t *expect, uint32_t len){
+    if (flash_crc32(addr, len) == flash_crc32_buf(expect, len)) return 0;
+
+    // mismatch: count the bad bytes the slow way
+    uint8_t tmp[256];
+    uint32_t bad = 0;
+    for (uint32_t off = 0; off < len; off += sizeof tmp) {
+        uint32_t n = (len - off > sizeof tmp) ? sizeof tmp : (len - off);
+        read_data(addr + off, tmp, n);
+        for (uint32_t i = 0; i < n; i++) if (tmp[i] != expect[off + i]) bad++;
+    }
+    return bad ? bad : 1u;                       // a CRC miss with no byte miss is still a fail
 }
 
-void page_program(uint32_t addr, const uint8_t *data, uint32_t len){
+// Short poll for one AAI word / byte program (tBP is ~10 us)
+static bool aai_wait(void){
+    absolute_time_t t0 = get_absolute_time();
+    while (read_status(0x05) & 0x01) {
+        if (absolute_time_diff_us(t0, get_absolute_time()) > FLASH_AAI_WORD_TOUT_US) return false;
+    }
+    return true;
+}
+
+static bool byte_program(uint32_t addr, uint8_t b){
+    uint8_t cmd[6];
+    uint32_t n = cmd_hdr(cmd, 0x02, addr);
+    cmd[n++] = b;
     write_enable();
-    uint8_t hdr[4] = {0x02, (uint8_t)(addr>>16),(uint8_t)(addr>>8),(uint8_t)addr};
-    cs_low(); spi_write_blocking(spi0, hdr, 4);
-    spi_write_blocking(spi0, data, (int)len); cs_high();
-    wait_wip_clear();
+    cs_low(); spi_write_blocking(s_cur->spi, cmd, n); cs_high();
+    return aai_wait();
+}
+
+// SST25 AAI word program: an odd head/tail byte goes through byte program,
+// the rest is one AAI sequence (address sent once, then 0xAD + 2 bytes per
+// word) closed with WRDI. No page boundaries to respect.
+static bool aai_program(uint32_t addr, const uint8_t *data, uint32_t len){
+    bool ok = true;
+    if (len && (addr & 1u)) {
+        ok = byte_program(addr, *data);
+        addr++; data++; len--;
+    }
+    if (ok && len >= 2u) {
+        uint8_t cmd[7];
+        uint32_t n = cmd_hdr(cmd, 0xAD, addr);
+        cmd[n++] = data[0];
+        cmd[n++] = data[1];
+        write_enable();
+        cs_low(); spi_write_blocking(s_cur->spi, cmd, n); cs_high();
+        ok = aai_wait();
+        uint32_t done = 2u;
+        while (ok && len - done >= 2u) {
+            uint8_t w[3] = { 0xAD, data[done], data[done + 1u] };
+            cs_low(); spi_write_blocking(s_cur->spi, w, 3); cs_high();
+            ok = aai_wait();
+            done += 2u;
+        }
+        uint8_t wrdi = 0x04;
+        cs_low(); spi_write_blocking(s_cur->spi, &wrdi, 1); cs_high();
+        addr += done; data += done; len -= done;
+    }
+    if (ok && len) ok = byte_program(addr, *data);
+    if (!ok) printf("flash: AAI program stuck at 0x%06X\r\n", (unsigned)addr);
+    return ok;
+}
+
+// On AAI parts the whole program runs here and WIP is already clear on return.
+static bool prog_cmd(uint32_t addr, const uint8_t *data, uint32_t len){
+    if (s_cur->prog_path == PROG_AAI) {
+        bool ok = aai_program(addr, data, len);   // per-word polls included
+        flash_phase_mark(FLASH_PH_DATA);
+        return ok;
+    }
+    uint8_t hdr[5];
+    uint32_t n = cmd_hdr(hdr, s_cur->op_prog, addr);
+    cs_low(); spi_write_blocking(s_cur->spi, hdr, n);
+    flash_phase_mark(FLASH_PH_CMD);
+    spi_write_blocking(s_cur->spi, data, (int)len); cs_high();
+    flash_phase_mark(FLASH_PH_DATA);
+    return true;
+}
+
+static void erase_cmd(flash_wait_kind_t kind, uint32_t addr){
+    uint8_t cmd[5];
+    uint32_t n;
+    switch (kind) {
+    case FLASH_WAIT_ERASE_32K: n = cmd_hdr(cmd, s_cur->op_erase32k, addr); break;
+    case FLASH_WAIT_ERASE_64K: n = cmd_hdr(cmd, s_cur->op_erase64k, addr); break;
+    case FLASH_WAIT_CHIP:      cmd[0] = 0xC7; n = 1;                  break;
+    default:                   n = cmd_hdr(cmd, s_cur->op_erase4k, addr);  break;
+    }
+    cs_low(); spi_write_blocking(s_cur->spi, cmd, n); cs_high();
+    flash_phase_mark(FLASH_PH_CMD);
+}
+
+// Block size -> wait kind; FLASH_WAIT_KINDS if the part has no such erase.
+static flash_wait_kind_t erase_kind(uint32_t size){
+    if (!flash_erase_supported(size)) return FLASH_WAIT_KINDS;
+    if (size == 4096u)           return FLASH_WAIT_ERASE_4K;
+    if (size == 32u * 1024u)     return FLASH_WAIT_ERASE_32K;
+    if (size == 64u * 1024u)     return FLASH_WAIT_ERASE_64K;
+    if (s_cur->capacity && size == s_cur->capacity) return FLASH_WAIT_CHIP;
+    return FLASH_WAIT_KINDS;
 }
 
-void sector_erase_4k(uint32_t addr){
+void page_program_start(uint32_t addr, const uint8_t *data, uint32_t len){
     write_enable();
-    uint8_t cmd[4] = {0x20,(uint8_t)(addr>>16),(uint8_t)(addr>>8),(uint8_t)addr};
-    cs_low(); spi_write_blocking(spi0, cmd, 4); cs_high();
-    wait_wip_clear();
+    flash_phase_mark(FLASH_PH_WREN);
+    prog_cmd(addr, data, len);
+}
+
+bool page_program(uint32_t addr, const uint8_t *data, uint32_t len){
+    page_program_start(addr, data, len);
+    return flash_wait_ready(FLASH_WAIT_PROG, true);
+}
+
+// Bytes from addr to the end of its page, capped by the staging buffer
+static uint32_t stream_chunk(uint32_t addr, uint32_t left){
+    uint32_t n = s_cur->page_size - (addr & (s_cur->page_size - 1u));
+    if (n > FLASH_STAGE_BYTES) n = FLASH_STAGE_BYTES;
+    return n < left ? n : left;
+}
+
+bool flash_write_stream(uint32_t addr, const uint8_t *src, uint32_t len){
+    static uint8_t stage[2][FLASH_STAGE_BYTES];
+    if (!len) return true;
+    if (s_cur->prog_path == PROG_AAI) return aai_program(addr, src, len);   // one sequence, no pages
+
+    uint32_t cur = 0;
+    uint32_t n   = stream_chunk(addr, len);
+    memcpy(stage[cur], src, n);
+    while (n) {
+        uint8_t hdr[5];
+        uint32_t h = cmd_hdr(hdr, s_cur->op_prog, addr);
+        write_enable();
+        flash_phase_mark(FLASH_PH_WREN);
+        cs_low(); spi_write_blocking(s_cur->spi, hdr, h);
+        flash_phase_mark(FLASH_PH_CMD);
+        if (n >= FLASH_DMA_MIN_BYTES && flash_dma_init()) {
+            flash_dma_start_tx(stage[cur], n);
+            dma_channel_wait_for_finish_blocking((uint)s_dma_rx);
+        } else {
+            spi_write_blocking(s_cur->spi, stage[cur], (int)n);
+        }
+        cs_high();
+        flash_phase_mark(FLASH_PH_DATA);
+        absolute_time_t t0 = get_absolute_time();
+
+        // stage the next page while this one programs
+        addr += n; src += n; len -= n;
+        uint32_t next = len ? stream_chunk(addr, len) : 0;
+        if (next) memcpy(stage[cur ^ 1u], src, next);
+
+        if (!wait_ready_from(FLASH_WAIT_PROG, t0, false)) return false;
+        cur ^= 1u;
+        n = next;
+    }
+    return true;
+}
+
+void sector_erase_4k_start(uint32_t addr){
+    write_enable();
+    flash_phase_mark(FLASH_PH_WREN);
+    erase_cmd(FLASH_WAIT_ERASE_4K, addr);
+}
+
+bool sector_erase_4k(uint32_t addr){
+    sector_erase_4k_start(addr);
+    return flash_wait_ready(FLASH_WAIT_ERASE_4K, true);
+}
+
+bool flash_erase_block(uint32_t addr, uint32_t size){
+    flash_wait_kind_t kind = erase_kind(size);
+    if (kind == FLASH_WAIT_KINDS || (addr & (size - 1u))) {
+        printf("flash: bad erase %u bytes at 0x%06X\r\n", (unsigned)size, (unsigned)addr);
+        return false;
+    }
+    write_enable();
+    flash_phase_mark(FLASH_PH_WREN);
+    erase_cmd(kind, addr);
+    return flash_wait_ready(kind, true);
+}
+
+uint32_t flash_erase_plan_step(uint32_t addr, uint32_t end){
+    if (addr & 0xFFFu || addr >= end) return 0;
+    if (addr == 0 && s_cur->capacity && end >= s_cur->capacity) return s_cur->capacity;
+    // aligned power-of-two blocks, so greedy largest-first is also the fewest
+    static const uint32_t sizes[] = { 64u * 1024u, 32u * 1024u, 4096u };
+    for (unsigned i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        uint32_t sz = sizes[i];
+        if (flash_erase_supported(sz) && (addr & (sz - 1u)) == 0 && end - addr >= sz) return sz;
+    }
+    return 4096u;                   // tail shorter than 4K: sector is rounded out
+}
+
+// ---- Blank check ----
+static flash_blank_stats_t s_blank;
+
+bool flash_buf_is_blank(const uint8_t *p, uint32_t len){
+    while (len && ((uintptr_t)p & 3u)) { if (*p++ != 0xFFu) return false; len--; }
+    const uint32_t *w = (const uint32_t *)(const void *)p;
+    for (uint32_t i = 0; i < len / 4u; i++) if (w[i] != 0xFFFFFFFFu) return false;
+    p += len & ~3u;
+    for (uint32_t i = 0; i < (len & 3u); i++) if (p[i] != 0xFFu) return false;
+    return true;
+}
+
+bool flash_is_blank(uint32_t addr, uint32_t len){
+    static uint32_t buf[FLASH_BLANK_CHUNK / 4u];
+    uint32_t n = FLASH_PAGE_SIZE < FLASH_BLANK_CHUNK ? FLASH_PAGE_SIZE : FLASH_BLANK_CHUNK;
+    while (len) {
+        if (n > len) n = len;
+        read_data(addr, (uint8_t *)buf, n);
+        if (!flash_buf_is_blank((const uint8_t *)buf, n)) return false;
+        addr += n; len -= n;
+        n = FLASH_BLANK_CHUNK;
+    }
+    return true;
+}
+
+// Dirty run from the last scan: sectors [lo, hi) all read back non-blank;
+// 'capped' = the scan stopped at its limit, not at a blank sector. A
+// whole-chip scan that ends in a 64K step leaves the rest of its run here,
+// so the following calls don't read it again. Forgotten at the start of
+// each erase pass, since programs in between can make it stale.
+static struct { const flash_dev_t *dev; uint32_t lo, hi, end; bool capped; } s_dirty;
+
+static void dirty_forget(void) { s_dirty.dev = NULL; }
+
+uint32_t flash_erase_plan_dirty(uint32_t addr, uint32_t end){
+    if (addr & 0xFFFu || addr >= end) return 0;
+
+    absolute_time_t t0 = get_absolute_time();
+    bool known = s_dirty.dev == s_cur && s_dirty.end == end && addr >= s_dirty.lo && addr < s_dirty.hi;
+    bool blank = false;
+    uint32_t run;
+    s_blank.checked++;
+    if (known) {
+        run = s_dirty.hi;
+    } else {
+        blank = flash_is_blank(addr, FLASH_ERASE_SIZE);
+        run = addr + FLASH_ERASE_SIZE;
+    }
+    if (!blank && (!known || s_dirty.capped)) {
+        // grow the dirty run up to the next blank sector; only a run from 0
+        // to the end may turn into a chip erase, otherwise 64K is the most
+        // the planner would use
+        bool whole = addr == 0 && s_cur->capacity && end >= s_cur->capacity;
+        uint32_t limit = whole ? end : addr + 64u * 1024u;
+        if (limit > end) limit = end;
+        bool capped = run < end;
+        while (run < limit) {
+            if (flash_is_blank(run, FLASH_ERASE_SIZE)) { capped = false; break; }
+            run += FLASH_ERASE_SIZE;
+            capped = run < end;
+        }
+        if (!known) { s_dirty.dev = s_cur; s_dirty.lo = addr; s_dirty.end = end; }
+        s_dirty.hi = run;
+        s_dirty.capped = capped;
+    }
+    s_blank.check_us += (uint32_t)absolute_time_diff_us(t0, get_absolute_time());
+
+    if (blank) {
+        s_blank.skipped++;
+        s_blank.saved_us += s_cur->wait[FLASH_WAIT_ERASE_4K].est_us;
+        return 0;
+    }
+    return flash_erase_plan_step(addr, run);
+}
+
+void flash_blank_stats_reset(void) { memset(&s_blank, 0, sizeof s_blank); }
+flash_blank_stats_t flash_blank_stats(void) { return s_blank; }
+
+bool flash_erase_range(uint32_t addr, uint32_t len, bool may_sleep){
+    uint32_t end = (addr + len + 0xFFFu) & ~0xFFFu;
+    addr &= ~0xFFFu;
+    dirty_forget();
+    while (addr < end) {
+        uint32_t sz = flash_erase_plan_dirty(addr, end);
+        if (!sz) { addr += FLASH_ERASE_SIZE; continue; }      // already blank
+        flash_wait_kind_t kind = erase_kind(sz);
+        write_enable();
+        erase_cmd(kind, addr);
+        if (!flash_wait_ready(kind, may_sleep)) return false;
+        addr += sz;
+    }
+    return true;
+}
+
+// ========== Non-blocking erase/program ==========
+static flash_op_state_t op_finish(bool ok){
+    if (s_fop.step == OP_STEP_WIP) flash_phase_mark(FLASH_PH_WIP);
+    s_fop.state = ok ? FLASH_OP_DONE : FLASH_OP_FAILED;
+    if (ok) wait_learn(s_fop.kind, s_fop.elapsed_us);
+    if (s_fop.cb) s_fop.cb(ok, s_fop.elapsed_us, s_fop.ctx);
+    return s_fop.state;
+}
+
+static bool op_submit(flash_wait_kind_t kind, uint32_t addr, const uint8_t *data,
+                      uint32_t len, flash_op_cb_t done, void *ctx){
+    if (s_fop.state == FLASH_OP_BUSY || s_fop.state == FLASH_OP_SUSPENDED) return false;
+    s_fop.kind = kind;
+    s_fop.addr = addr;
+    s_fop.data = data;
+    s_fop.len  = len;
+    s_fop.cb   = done;
+    s_fop.ctx  = ctx;
+    s_fop.wren_tries = 0;
+    s_fop.elapsed_us = 0;
+    s_fop.t_next_suspend = get_absolute_time();
+    s_fop.step  = OP_STEP_WREN;
+    s_fop.state = FLASH_OP_BUSY;
+    flash_op_poll();                 // WREN + command go out now
+    return true;
+}
+
+bool flash_op_submit_erase_4k(uint32_t addr, flash_op_cb_t done, void *ctx){
+    return op_submit(FLASH_WAIT_ERASE_4K, addr, NULL, 0, done, ctx);
+}
+
+bool flash_op_submit_erase(uint32_t addr, uint32_t size, flash_op_cb_t done, void *ctx){
+    flash_wait_kind_t kind = erase_kind(size);
+    if (kind == FLASH_WAIT_KINDS || (addr & (size - 1u))) return false;
+    return op_submit(kind, addr, NULL, 0, done, ctx);
+}
+
+bool flash_op_submit_program(uint32_t addr, const uint8_t *data, uint32_t len,
+                             flash_op_cb_t done, void *ctx){
+    return op_submit(FLASH_WAIT_PROG, addr, data, len, done, ctx);
+}
+
+flash_op_state_t flash_op_poll(void){
+    if (s_fop.state != FLASH_OP_BUSY) return s_fop.state;
+
+    switch (s_fop.step) {
+    case OP_STEP_WREN:
+        write_enable();
+        if (!(read_status(0x05) & 0x02)) {           // WEL didn't latch
+            if (++s_fop.wren_tries < 3) return FLASH_OP_BUSY;
+            printf("flash: WEL not set at 0x%06X (write protected?)\r\n", (unsigned)s_fop.addr);
+            return op_finish(false);
+        }
+        flash_phase_mark(FLASH_PH_WREN);
+        s_fop.step = OP_STEP_CMD;
+        // fall through
+    case OP_STEP_CMD:
+        if (s_fop.kind != FLASH_WAIT_PROG) erase_cmd(s_fop.kind, s_fop.addr);
+        else if (!prog_cmd(s_fop.addr, s_fop.data, s_fop.len)) return op_finish(false);
+        s_fop.t_cmd = get_absolute_time();
+        s_fop.step  = OP_STEP_WIP;
+        return FLASH_OP_BUSY;
+    case OP_STEP_WIP: {
+        uint8_t sr = read_status(0x05);
+        s_fop.elapsed_us = (uint32_t)absolute_time_diff_us(s_fop.t_cmd, get_absolute_time());
+        if (!(sr & 0x01)) return op_finish(true);
+        if (s_fop.elapsed_us > wait_timeout_us(s_fop.kind)) {
+            printf("flash: %s at 0x%06X still busy after %u us (SR1=%02X)\r\n",
+                   s_wait_name[s_fop.kind], (unsigned)s_fop.addr, (unsigned)s_fop.elapsed_us, sr);
+            return op_finish(false);
+        }
+        return FLASH_OP_BUSY;
+    }
+    }
+    return s_fop.state;
+}
+
+flash_op_state_t flash_op_wait(bool may_sleep){
+    flash_op_state_t st;
+    while ((st = flash_op_poll()) == FLASH_OP_BUSY) {
+        if (may_sleep) sleep_us(50);
+        else tight_loop_contents();
+    }
+    return st;
+}
+
+uint32_t flash_op_elapsed_us(void){
+    if (s_fop.state == FLASH_OP_SUSPENDED)
+        return (uint32_t)absolute_time_diff_us(s_fop.t_cmd, s_fop.t_suspend);
+    if (s_fop.state == FLASH_OP_BUSY && s_fop.step == OP_STEP_WIP)
+        return (uint32_t)absolute_time_diff_us(s_fop.t_cmd, get_absolute_time());
+    return s_fop.elapsed_us;
+}
+
+// ========== Erase/program suspend ==========
+bool flash_suspend_supported(void) { return s_cur->sus_ok; }
+
+uint8_t flash_sus_status(void){
+    uint8_t mask = s_cur->sus_erase_sr2 | s_cur->sus_prog_sr2;
+    return mask ? (uint8_t)(read_status(0x35) & mask) : 0;
+}
+
+bool flash_op_suspend(void){
+    if (!s_cur->sus_ok || s_fop.state != FLASH_OP_BUSY || s_fop.step != OP_STEP_WIP) return false;
+    bool prog = (s_fop.kind == FLASH_WAIT_PROG);
+
+    // suspending again too soon after a resume can starve the operation
+    while (!time_reached(s_fop.t_next_suspend)) { tight_loop_contents(); }
+
+    uint8_t cmd = prog ? s_cur->op_psus : s_cur->op_esus;
+    absolute_time_t t0 = get_absolute_time();
+    cs_low(); spi_write_blocking(s_cur->spi, &cmd, 1); cs_high();
+
+    // WIP drops within the suspend latency, whether it parked or finished
+    uint32_t lat = (prog ? s_cur->psus_us : s_cur->esus_us) * 2u + 10u;
+    uint8_t sr;
+    while ((sr = read_status(0x05)) & 0x01) {
+        if ((uint32_t)absolute_time_diff_us(t0, get_absolute_time()) > lat) {
+            printf("flash: %s at 0x%06X did not suspend (SR1=%02X)\r\n",
+                   s_wait_name[s_fop.kind], (unsigned)s_fop.addr, sr);
+            return false;            // still running; flash_op_poll() carries on
+        }
+    }
+    s_fop.t_suspend = t0;
+
+    uint8_t mask = prog ? s_cur->sus_prog_sr2 : s_cur->sus_erase_sr2;
+    if (mask && !(read_status(0x35) & mask)) {
+        // finished before the suspend landed
+        s_fop.elapsed_us = (uint32_t)absolute_time_diff_us(s_fop.t_cmd, t0);
+        op_finish(true);
+        return false;
+    }
+    s_fop.state = FLASH_OP_SUSPENDED;
+    return true;
+}
+
+bool flash_op_resume(void){
+    if (s_fop.state != FLASH_OP_SUSPENDED) return false;
+    bool prog = (s_fop.kind == FLASH_WAIT_PROG);
+    uint8_t cmd = prog ? s_cur->op_pres : s_cur->op_eres;
+    cs_low(); spi_write_blocking(s_cur->spi, &cmd, 1); cs_high();
+
+    // the suspended stretch counts towards neither elapsed nor the timeout
+    absolute_time_t now = get_absolute_time();
+    s_fop.t_cmd = delayed_by_us(s_fop.t_cmd, (uint64_t)absolute_time_diff_us(s_fop.t_suspend, now));
+    s_fop.t_next_suspend = delayed_by_us(now, prog ? s_cur->pgap_us : s_cur->egap_us);
+    s_fop.state = FLASH_OP_BUSY;
+    return true;
 }
 
 // Many SPI NORs support JEDEC soft reset: 0x66 (Reset Enable), then 0x99 (Reset)
@@ -88,26 +1331,27 @@ void flash_soft_reset(void){
     uint8_t cmd;
     cmd = 0x66; 
     cs_low(); 
-    spi_write_blocking(spi0, &cmd, 1); 
+    spi_write_blocking(s_cur->spi, &cmd, 1); 
     cs_high();
     sleep_us(2);
     cmd = 0x99; 
     cs_low(); 
-    spi_write_blocking(spi0, &cmd, 1); 
+    spi_write_blocking(s_cur->spi, &cmd, 1); 
     cs_high();
     sleep_ms(1);
+    // reset drops the part back to 3-byte addressing, and SST26 re-locks
+    if (s_cur->en4b) flash_enter_4byte_mode();
+    if (s_cur->sst_type == 0x26) sst_unlock();
 }
 
-void wait_wip_clear_web_safe(void){
-    while (read_status(0x05) & 1) { 
-        tight_loop_contents();  // ← Web-safe!
-    }
+bool wait_wip_clear_web_safe(void){
+    return flash_wait_ready(FLASH_WAIT_OTHER, false);  // ← Web-safe!
 }
 
 void flash_release_from_dp(void){
     uint8_t cmd = 0xAB;
     cs_low(); 
-    spi_write_blocking(spi0, &cmd, 1); 
+    spi_write_blocking(s_cur->spi, &cmd, 1); 
     cs_high();
     sleep_us(50);
 }
@@ -115,86 +1359,351 @@ void flash_release_from_dp(void){
 void flash_recover_to_safe_mode(void){
     flash_release_from_dp();
     flash_soft_reset();
-    spi_init(spi0, 12000000);  // Safe 12MHz
+    spi_init(s_cur->spi, 12000000);  // Safe 12MHz
+    s_cur->hz = 12000000;
     cs_high();
     sleep_ms(1);
 }
 
+// ========== Resume journal ==========
+// "<image>.jnl" next to the image records how far a backup or restore
+// got, rewritten after every FLASH_JNL_EXTENT of flash. Running the same
+// job again picks up there, once the last extent still checks out against
+// the chip, and finishes with a whole-image check. Deleted on success.
+#define FLASH_JNL_MAGIC  0x314E4A46u     // "FJN1"
+#define FLASH_JNL_EXTENT (64u * 1024u)
+enum { JNL_BACKUP = 1, JNL_RESTORE = 2 };
+
+typedef struct {
+    uint32_t magic;
+    uint32_t op;            // JNL_BACKUP / JNL_RESTORE
+    uint32_t flags;         // backup: compressed
+    uint32_t image_bytes;   // flash bytes the job covers
+    uint32_t file_bytes;    // restore: image file size, to spot a different file
+    uint8_t  jedec[4];
+    uint32_t done;          // flash bytes finished: whole extents, from 0
+    uint32_t file_pos;      // image file offset that goes with 'done'
+    uint32_t chain;         // block-CRC chain over [0, done)
+    uint32_t extent_crc;    // block-CRC chain over the last extent on its own
+    uint32_t crc;           // of everything above
+} flash_jnl_t;
+
+// Image CRC as .fbk files and the journal keep it: a CRC over the CRCs
+// of each 4K block (stored little-endian), so it can be built a block at
+// a time from either side.
+static uint32_t crc_chain(uint32_t chain, uint32_t blk_crc) {
+    uint8_t b[4] = { (uint8_t)blk_crc, (uint8_t)(blk_crc >> 8),
+                     (uint8_t)(blk_crc >> 16), (uint8_t)(blk_crc >> 24) };
+    return flash_crc32_sw(chain, b, 4);
+}
+
+static uint32_t flash_chain_crc(uint32_t from, uint32_t to) {
+    uint32_t chain = FLASH_CRC32_SEED;
+    for (uint32_t a = from; a < to; a += FLASH_ERASE_SIZE)
+        chain = crc_chain(chain, flash_crc32(a, (to - a > FLASH_ERASE_SIZE) ? FLASH_ERASE_SIZE : (to - a)));
+    return chain;
+}
+
+static void jnl_path(char *out, size_t len, const char *path) { snprintf(out, len, "%s.jnl", path); }
+
+static bool jnl_load(const char *path, uint32_t op, flash_jnl_t *j) {
+    char jp[96];
+    FIL jf;
+    UINT br = 0;
+    jnl_path(jp, sizeof jp, path);
+    if (f_open(&jf, jp, FA_READ | FA_OPEN_EXISTING) != FR_OK) return false;
+    FRESULT fr = f_read(&jf, j, sizeof *j, &br);
+    f_close(&jf);
+    if (fr != FR_OK || br != sizeof *j || j->magic != FLASH_JNL_MAGIC || j->op != op) return false;
+    if (j->crc != flash_crc32_sw(FLASH_CRC32_SEED, (const uint8_t *)j, offsetof(flash_jnl_t, crc))) return false;
+
+    // the chip must be the one the job was on, with its last extent intact
+    uint8_t id[4] = { 0 };
+    read_jedec_id(id);
+    if (memcmp(id, j->jedec, sizeof id) != 0 || j->done == 0 || j->done >= j->image_bytes) return false;
+    return flash_chain_crc(j->done - FLASH_JNL_EXTENT, j->done) == j->extent_crc;
+}
+
+// Best effort: a lost update only means resuming an extent earlier.
+static void jnl_save(const char *path, flash_jnl_t *j) {
+    char jp[96];
+    FIL jf;
+    UINT bw = 0;
+    jnl_path(jp, sizeof jp, path);
+    j->magic = FLASH_JNL_MAGIC;
+    j->crc = flash_crc32_sw(FLASH_CRC32_SEED, (const uint8_t *)j, offsetof(flash_jnl_t, crc));
+    if (f_open(&jf, jp, FA_OPEN_ALWAYS | FA_WRITE) != FR_OK) return;
+    f_write(&jf, j, sizeof *j, &bw);
+    f_close(&jf);
+}
+
+static void jnl_clear(const char *path) {
+    char jp[96];
+    jnl_path(jp, sizeof jp, path);
+    f_unlink(jp);
+}
+
+static void jnl_begin(flash_jnl_t *j, uint32_t op, uint32_t flags, uint32_t image_bytes) {
+    memset(j, 0, sizeof *j);
+    j->op = op;
+    j->flags = flags;
+    j->image_bytes = image_bytes;
+    read_jedec_id(j->jedec);
+    j->chain = j->extent_crc = FLASH_CRC32_SEED;
+}
+
+// Fold one finished 4K block into the journal; at an extent boundary
+// (short of the end) record it with the image file position to resume at.
+// The image file is synced first so the journal never runs ahead of it.
+static FRESULT jnl_block_done(const char *path, flash_jnl_t *j, uint32_t end_addr,
+                              uint32_t blk_crc, FIL *sync_f, uint32_t file_pos) {
+    j->chain = crc_chain(j->chain, blk_crc);
+    j->extent_crc = crc_chain(j->extent_crc, blk_crc);
+    if ((end_addr % FLASH_JNL_EXTENT) != 0 || end_addr >= j->image_bytes) return FR_OK;
+    FRESULT fr = sync_f ? f_sync(sync_f) : FR_OK;
+    if (fr != FR_OK) return fr;
+    j->done = end_addr;
+    j->file_pos = file_pos;
+    jnl_save(path, j);
+    j->extent_crc = FLASH_CRC32_SEED;
+    return FR_OK;
+}
+
 // ========== BACKUP: Dump entire flash to SD card ==========
-FRESULT flash_backup_to_file(const char *path, uint32_t flash_bytes) {
-    FRESULT fr;
-    FIL f;
+// Compressed body (flash_pack.h): the header goes out first and is
+// rewritten with the image CRC at the end. The next block streams in by
+// DMA while the current one is coded and written to the card.
+static FRESULT backup_packed(FIL *f, const char *path, flash_jnl_t *j) {
+    static uint8_t blk[2][FPACK_BLOCK];
+    static uint8_t pk[FPACK_BLOCK];
+    uint8_t hb[FPACK_HDR_BYTES], rh[FPACK_REC_BYTES];
+    uint32_t flash_bytes = j->image_bytes;
+    fpack_hdr_t h = { .capacity = flash_capacity_bytes(), .image_bytes = flash_bytes,
+                      .block_bytes = FPACK_BLOCK };
+    uint32_t n_enc[4] = { 0 };
+    uint32_t file_bytes = j->done ? j->file_pos : FPACK_HDR_BYTES;
     UINT bw = 0;
-    uint8_t buf[512];
-    
-    printf("DEBUG: Mounting SD card...\r\n");
-    fr = ensure_sd_and_folder();
+    FRESULT fr = FR_OK;
+
+    memcpy(h.jedec, j->jedec, 3);
+    if (!j->done) {
+        fpack_hdr_write(&h, hb);                 // placeholder until the image CRC is known
+        fr = f_write(f, hb, sizeof hb, &bw);
+        if (fr == FR_OK && bw != sizeof hb) fr = FR_DISK_ERR;
+    }
+
+    uint32_t cur = 0;
+    uint32_t addr = j->done;
+    if (fr == FR_OK && addr < flash_bytes)
+        read_data_async(addr, blk[0], (flash_bytes - addr > FPACK_BLOCK) ? FPACK_BLOCK : (flash_bytes - addr),
+                        NULL, NULL);
+
+    for (; fr == FR_OK && addr < flash_bytes; addr += FPACK_BLOCK) {
+        uint32_t n = (flash_bytes - addr > FPACK_BLOCK) ? FPACK_BLOCK : (flash_bytes - addr);
+        flash_read_wait();
+        fpack_rec_t r;
+        r.crc = flash_crc32_buf(blk[cur], n);
+
+        uint32_t next = addr + FPACK_BLOCK;
+        if (next < flash_bytes)
+            read_data_async(next, blk[cur ^ 1u],
+                            (flash_bytes - next > FPACK_BLOCK) ? FPACK_BLOCK : (flash_bytes - next), NULL, NULL);
+
+        fpack_enc_t enc;
+        r.len = (uint16_t)fpack_encode(blk[cur], n, pk, &enc);
+        r.enc = (uint8_t)enc;
+        n_enc[enc]++;
+        fpack_rec_write(&r, rh);
+
+        fr = f_write(f, rh, sizeof rh, &bw);
+        if (fr == FR_OK && bw != sizeof rh) fr = FR_DISK_ERR;
+        if (fr == FR_OK && r.len) {
+            fr = f_write(f, pk, r.len, &bw);
+            if (fr == FR_OK && bw != r.len) fr = FR_DISK_ERR;
+        }
+        if (fr != FR_OK) {
+            printf("\r\nERROR: Write failed at 0x%06X (error %d)\r\n", addr, fr);
+            break;
+        }
+        file_bytes += FPACK_REC_BYTES + r.len;
+        cur ^= 1u;
+
+        fr = jnl_block_done(path, j, addr + n, r.crc, f, file_bytes);
+        if ((addr & ((256u * 1024u) - 1)) == 0) {
+            printf(".");
+            fflush(stdout);
+        }
+    }
+    flash_read_wait();
+    if (fr != FR_OK) return fr;
+
+    h.image_crc = j->chain;
+    fpack_hdr_write(&h, hb);
+    fr = f_lseek(f, 0);
+    if (fr == FR_OK) fr = f_write(f, hb, sizeof hb, &bw);
+    if (fr == FR_OK && bw != sizeof hb) fr = FR_DISK_ERR;
+    if (fr == FR_OK) fr = f_lseek(f, f_size(f));
     if (fr != FR_OK) {
-        printf("ERROR: SD mount failed (error %d)\r\n", fr);
+        printf("\r\nERROR: Header update failed (error %d)\r\n", fr);
         return fr;
     }
-    printf("DEBUG: SD mounted OK\r\n");
 
-    printf("DEBUG: Creating file: %s\r\n", path);
-    fr = f_open(&f, path, FA_CREATE_ALWAYS | FA_WRITE);
-    if (fr != FR_OK) { 
-        printf("ERROR: Failed to create file (error %d)\r\n", fr);
-        f_unmount("0:");
-        return fr;
+    printf("\r\nPacked %u KB of flash into %u KB (%u%%): %u erased, %u rle, %u lz, %u raw blocks\r\n",
+           (unsigned)(flash_bytes / 1024u), (unsigned)((file_bytes + 1023u) / 1024u),
+           (unsigned)(flash_bytes ? (uint64_t)file_bytes * 100u / flash_bytes : 0u),
+           (unsigned)n_enc[FPACK_ERASED], (unsigned)n_enc[FPACK_RLE],
+           (unsigned)n_enc[FPACK_LZ], (unsigned)n_enc[FPACK_RAW]);
+    return FR_OK;
+}
+
+// Raw body: a ring of FLASH_BACKUP_BUFS buffers. Flash reads run back to
+// back by DMA, each completion IRQ starting the next into a free buffer,
+// while the main loop writes the filled ones to the card. spi0 and spi1
+// are busy at the same time, so the backup takes about as long as the
+// slower bus rather than the sum of both.
+typedef struct {
+    uint32_t          next_addr;    // next flash address to read
+    volatile uint32_t end;          // pulled in to stop the chain on an error
+    volatile uint32_t filled;       // buffers read so far
+    volatile uint32_t written;      // buffers written so far
+    volatile bool     reading;      // a read is in flight
+} backup_ring_t;
+
+static uint8_t s_backup_buf[FLASH_BACKUP_BUFS][FLASH_BACKUP_CHUNK] __attribute__((aligned(4)));
+
+static void backup_ring_start(backup_ring_t *r);
+
+static void backup_ring_done(void *ctx) {
+    backup_ring_t *r = ctx;
+    r->filled++;
+    backup_ring_start(r);
+}
+
+// Runs from the DMA IRQ, or from the main loop when no read is in flight.
+static void backup_ring_start(backup_ring_t *r) {
+    uint32_t idx = r->filled;
+    if (r->next_addr >= r->end || idx - r->written >= FLASH_BACKUP_BUFS) {
+        r->reading = false;          // done, or every buffer is waiting for the card
+        return;
     }
-    printf("DEBUG: File opened for writing\r\n");
+    uint32_t addr = r->next_addr;
+    uint32_t n = (r->end - addr > FLASH_BACKUP_CHUNK) ? FLASH_BACKUP_CHUNK : (r->end - addr);
+    r->next_addr = addr + n;
+    r->reading = true;
+    read_data_async(addr, s_backup_buf[idx % FLASH_BACKUP_BUFS], n, backup_ring_done, r);
+}
 
-    printf("Backing up %u bytes...\r\n", (unsigned)flash_bytes);
+static FRESULT backup_raw(FIL *f, const char *path, flash_jnl_t *j) {
+    uint32_t start = j->done, flash_bytes = j->image_bytes;
+    backup_ring_t r = { .next_addr = start, .end = flash_bytes };
+    FRESULT fr = FR_OK;
 
-    uint32_t total_written = 0;
-    
-    for (uint32_t addr = 0; addr < flash_bytes; addr += sizeof(buf)) {
-        uint32_t chunk = (flash_bytes - addr > sizeof(buf)) ? sizeof(buf) : (flash_bytes - addr);
-        
-        // Read from flash
-        read_data(addr, buf, chunk);
-        
-        // Write to SD
-        bw = 0;
-        fr = f_write(&f, buf, (UINT)chunk, &bw);
-        
+    backup_ring_start(&r);
+    for (uint32_t i = 0, addr = start; addr < flash_bytes; i++, addr += FLASH_BACKUP_CHUNK) {
+        uint32_t n = (flash_bytes - addr > FLASH_BACKUP_CHUNK) ? FLASH_BACKUP_CHUNK : (flash_bytes - addr);
+        while (r.filled <= i) { tight_loop_contents(); }
+        const uint8_t *buf = s_backup_buf[i % FLASH_BACKUP_BUFS];
+
+        UINT bw = 0;
+        fr = f_write(f, buf, (UINT)n, &bw);
         if (fr != FR_OK) {
             printf("\r\nERROR: Write failed at 0x%06X (error %d)\r\n", addr, fr);
-            goto cleanup;
+            break;
         }
-        
-        if (bw != chunk) {
-            printf("\r\nERROR: Partial write at 0x%06X (wrote %u/%u)\r\n", 
-                   addr, (unsigned)bw, (unsigned)chunk);
+        if (bw != n) {
+            printf("\r\nERROR: Partial write at 0x%06X (wrote %u/%u)\r\n",
+                   addr, (unsigned)bw, (unsigned)n);
             fr = FR_DISK_ERR;
-            goto cleanup;
-        }
-        
-        total_written += bw;
-        
-        // Sync every 64KB to force actual SD writes
-        if ((addr % (64 * 1024)) == 0) {
-            fr = f_sync(&f);
-            if (fr != FR_OK) {
-                printf("\r\nERROR: Sync failed at 0x%06X (error %d)\r\n", addr, fr);
-                goto cleanup;
-            }
+            break;
+        }
+        // block CRCs for the journal, before the buffer goes back to the ring
+        for (uint32_t o = 0; fr == FR_OK && o < n; o += FLASH_ERASE_SIZE) {
+            uint32_t bn = (n - o > FLASH_ERASE_SIZE) ? FLASH_ERASE_SIZE : (n - o);
+            fr = jnl_block_done(path, j, addr + o + bn, flash_crc32_buf(buf + o, bn), f, addr + o + bn);
+        }
+        if (fr != FR_OK) {
+            printf("\r\nERROR: Sync failed at 0x%06X (error %d)\r\n", addr, fr);
+            break;
         }
-        
-        // Progress every 256KB
+        r.written++;
+        if (!r.reading) backup_ring_start(&r);   // the ring had stalled on a full buffer set
+
         if ((addr & ((256u * 1024u) - 1)) == 0) {
             printf(".");
             fflush(stdout);
         }
     }
+    r.end = r.next_addr;                // no new reads past the one in flight
+    flash_read_wait();
+    printf("\r\n");
+    return fr;
+}
+
+FRESULT flash_backup_to_file(const char *path, uint32_t flash_bytes, bool compress) {
+    FRESULT fr;
+    FIL f;
+    flash_jnl_t j;
     
-    printf("\r\nWrote %u bytes total\r\n", (unsigned)total_written);
+    printf("DEBUG: Mounting SD card...\r\n");
+    fr = ensure_sd_and_folder();
+    if (fr != FR_OK) {
+        printf("ERROR: SD mount failed (error %d)\r\n", fr);
+        return fr;
+    }
+    printf("DEBUG: SD mounted OK\r\n");
+
+    // Pick up an interrupted run of the same backup: the file is cut back
+    // to the last journalled extent and carries on from there.
+    bool resumed = false;
+    if (jnl_load(path, JNL_BACKUP, &j) && j.flags == (uint32_t)compress && j.image_bytes == flash_bytes &&
+        f_open(&f, path, FA_WRITE | FA_OPEN_EXISTING) == FR_OK) {
+        if (f_size(&f) >= j.file_pos && f_lseek(&f, j.file_pos) == FR_OK && f_truncate(&f) == FR_OK) {
+            resumed = true;
+            printf("Resuming backup at 0x%06X (journal)\r\n", (unsigned)j.done);
+        } else {
+            f_close(&f);
+        }
+    }
+    if (!resumed) {
+        jnl_clear(path);
+        jnl_begin(&j, JNL_BACKUP, compress, flash_bytes);
+        printf("DEBUG: Creating file: %s\r\n", path);
+        fr = f_open(&f, path, FA_CREATE_ALWAYS | FA_WRITE);
+        if (fr != FR_OK) { 
+            printf("ERROR: Failed to create file (error %d)\r\n", fr);
+            f_unmount("0:");
+            return fr;
+        }
+    }
+    printf("DEBUG: File opened for writing\r\n");
+
+    uint32_t bytes = flash_bytes - j.done;
+    printf("Backing up %u bytes%s...\r\n", (unsigned)bytes, compress ? " (compressed)" : "");
+
+    absolute_time_t t0 = get_absolute_time();
+    fr = compress ? backup_packed(&f, path, &j) : backup_raw(&f, path, &j);
+    if (fr == FR_OK) {
+        uint32_t ms = (uint32_t)(absolute_time_diff_us(t0, get_absolute_time()) / 1000);
+        printf("Backed up %u bytes in %u ms (%u KB/s)\r\n", (unsigned)bytes,
+               (unsigned)ms, (unsigned)(ms ? (uint64_t)bytes / ms * 1000u / 1024u : 0u));
+    }
+    // a stitched-together image must still match the chip end to end
+    bool stale = false;
+    if (fr == FR_OK && resumed) {
+        if (flash_chain_crc(0, flash_bytes) != j.chain) {
+            printf("ERROR: Flash changed since the interrupted backup; image CRC mismatch\r\n");
+            fr = FR_INT_ERR;
+            stale = true;
+        } else {
+            printf("Image CRC matches flash (%08X)\r\n", (unsigned)j.chain);
+        }
+    }
 
-cleanup:
     printf("DEBUG: Final sync...\r\n");
-    fr = f_sync(&f);
-    if (fr != FR_OK) {
-        printf("ERROR: Final sync failed (error %d)\r\n", fr);
+    FRESULT sync_result = f_sync(&f);
+    if (sync_result != FR_OK) {
+        printf("ERROR: Final sync failed (error %d)\r\n", sync_result);
+        if (fr == FR_OK) fr = sync_result;
     }
     
     printf("DEBUG: Closing file...\r\n");
@@ -203,6 +1712,7 @@ cleanup:
         printf("ERROR: Close failed (error %d)\r\n", close_result);
         fr = close_result;
     }
+    if (fr == FR_OK || stale) jnl_clear(path);    // a stale image starts over next time
     
     printf("DEBUG: Unmounting...\r\n");
     f_unmount("0:");
@@ -217,12 +1727,89 @@ cleanup:
 }
 
 // ========== RESTORE (with web-safe option) ==========
-FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool verify) {
+// What a diff restore has to do to one sector.
+enum { RESTORE_SAME, RESTORE_PROG, RESTORE_ERASE };
+
+static int restore_classify(const uint8_t *want, const uint8_t *have, uint32_t len){
+    if (memcmp(want, have, len) == 0) return RESTORE_SAME;
+    for (uint32_t i = 0; i < len; i++) {
+        if ((have[i] & want[i]) != want[i]) return RESTORE_ERASE;   // needs a 0 -> 1
+    }
+    return RESTORE_PROG;                                              // only 1 -> 0 bits
+}
+
+// Program only the pages of [base, base+len) where 'want' differs from
+// 'have' (base is page aligned), merging neighbouring pages into one run.
+static bool restore_program_changed(uint32_t base, const uint8_t *want, const uint8_t *have,
+                                    uint32_t len, uint32_t *pages){
+    uint32_t pg = s_cur->page_size;
+    uint32_t off = 0;
+    while (off < len) {
+        uint32_t n = (len - off > pg) ? pg : (len - off);
+        if (memcmp(want + off, have + off, n) == 0) { off += n; continue; }
+        uint32_t run = off;
+        while (run < len) {
+            n = (len - run > pg) ? pg : (len - run);
+            if (memcmp(want + run, have + run, n) == 0) break;
+            run += n;
+            (*pages)++;
+        }
+        if (!flash_write_stream(base + off, want + off, run - off)) return false;
+        off = run;
+    }
+    return true;
+}
+
+// Where restore blocks come from: the raw dump, or .fbk records decoded
+// back into 4K blocks and CRC-checked on the way.
+typedef struct {
+    FIL     *f;
+    bool     packed;
+} restore_src_t;
+
+static FRESULT restore_read(restore_src_t *s, uint8_t *dst, UINT want, UINT *br) {
+    if (!s->packed) return f_read(s->f, dst, want, br);
+
+    static uint8_t pk[FPACK_BLOCK];
+    uint8_t rh[FPACK_REC_BYTES];
+    fpack_rec_t r;
+    UINT n = 0;
+    *br = 0;
+    FRESULT fr = f_read(s->f, rh, sizeof rh, &n);
+    if (fr != FR_OK || n == 0) return fr;          // EOF shows up as br == 0
+    fpack_rec_read(rh, &r);
+    if (n != sizeof rh || r.len > FPACK_BLOCK) return FR_INT_ERR;
+    fr = f_read(s->f, pk, r.len, &n);
+    if (fr != FR_OK) return fr;
+    if (n != r.len || !fpack_decode((fpack_enc_t)r.enc, pk, r.len, dst, want) ||
+        flash_crc32_buf(dst, want) != r.crc) {
+        printf("\r\nERROR: Corrupt %s record in backup\r\n", fpack_enc_name((fpack_enc_t)r.enc));
+        return FR_INT_ERR;
+    }
+    *br = want;
+    return FR_OK;
+}
+
+FRESULT flash_backup_image_bytes(const char *path, uint32_t *bytes) {
+    FIL f;
+    FRESULT fr = f_open(&f, path, FA_READ | FA_OPEN_EXISTING);
+    if (fr != FR_OK) return fr;
+    uint8_t hb[FPACK_HDR_BYTES];
+    fpack_hdr_t h;
+    UINT br = 0;
+    *bytes = (uint32_t)f_size(&f);
+    if (f_read(&f, hb, sizeof hb, &br) == FR_OK && br == sizeof hb && fpack_hdr_read(hb, &h))
+        *bytes = h.image_bytes;
+    f_close(&f);
+    return FR_OK;
+}
+
+FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool verify, bool diff) {
     FRESULT fr;
     FIL f;
     FILINFO finfo;
     UINT br;
-    static uint8_t buf[FLASH_ERASE_SIZE];
+    static uint8_t buf[2][FLASH_ERASE_SIZE];
     static uint8_t rb [FLASH_ERASE_SIZE];
 
     printf("DEBUG: Mounting SD card...\r\n");
@@ -247,7 +1834,25 @@ FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool ver
         return fr;
     }
 
+    // .fbk container or raw dump?
+    restore_src_t src = { .f = &f, .packed = false };
+    uint8_t hb[FPACK_HDR_BYTES];
+    fpack_hdr_t hdr;
     uint32_t todo = (uint32_t)f_size(&f);
+    br = 0;
+    if (f_read(&f, hb, sizeof hb, &br) == FR_OK && br == sizeof hb && fpack_hdr_read(hb, &hdr)) {
+        uint8_t id[3];
+        read_jedec_id(id);
+        src.packed = true;
+        todo = hdr.image_bytes;
+        printf("Compressed backup of %02X %02X %02X, %u KB image\r\n",
+               hdr.jedec[0], hdr.jedec[1], hdr.jedec[2], (unsigned)(todo / 1024u));
+        if (memcmp(id, hdr.jedec, 3) != 0)
+            printf("WARNING: backup is from %02X %02X %02X, this chip is %02X %02X %02X\r\n",
+                   hdr.jedec[0], hdr.jedec[1], hdr.jedec[2], id[0], id[1], id[2]);
+    } else {
+        f_lseek(&f, 0);
+    }
     if (todo == 0) {
         printf("ERROR: File size is 0\r\n");
         f_close(&f);
@@ -260,17 +1865,50 @@ FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool ver
         todo = flash_bytes;
     }
 
-    printf("Restoring %u bytes%s...\r\n", 
-           (unsigned)todo, verify ? " with verify" : "");
+    // Pick up an interrupted restore of the same image where it stopped
+    flash_jnl_t j;
+    bool resumed = false;
+    if (jnl_load(path, JNL_RESTORE, &j) && j.image_bytes == todo && j.file_bytes == (uint32_t)finfo.fsize &&
+        f_lseek(&f, j.file_pos) == FR_OK) {
+        resumed = true;
+        printf("Resuming restore at 0x%06X (journal)\r\n", (unsigned)j.done);
+    } else {
+        jnl_clear(path);
+        jnl_begin(&j, JNL_RESTORE, diff, todo);
+        j.file_bytes = (uint32_t)finfo.fsize;
+    }
+    uint32_t start = j.done;
 
-    for (uint32_t base = 0; base < todo; base += FLASH_ERASE_SIZE) {
-        uint32_t want = FLASH_ERASE_SIZE;
-        if (base + want > todo) want = todo - base;
+    printf("Restoring %u bytes%s%s...\r\n",
+           (unsigned)(todo - start), diff ? " (changed sectors only)" : "", verify ? " with verify" : "");
 
-        br = 0;
-        fr = f_read(&f, buf, (UINT)want, &br);
-        if (fr != FR_OK) {
-            printf("\r\nERROR: Read failed at 0x%06X (error %d)\r\n", base, fr);
+    // Double-buffered: the next block comes off the SD card (spi1) while
+    // the current sector erases on the flash bus (spi0).
+    // Erases come from the planner (64K/32K blocks, or one chip erase for a
+    // full image); blocks inside an already-erased span skip straight to
+    // programming. Sectors that are already blank aren't erased, and
+    // all-0xFF blocks of the image aren't programmed.
+    // In diff mode each sector is read and compared first: identical ones
+    // are left alone, ones that only clear bits are programmed in place
+    // (changed pages only), and the rest get a 4K erase + program.
+    flash_blank_stats_reset();
+    uint32_t ff_blocks = 0;
+    uint32_t n_same = 0, n_prog = 0, n_erase = 0, n_pages = 0;
+    absolute_time_t t_start = get_absolute_time();
+    uint32_t cur = 0;
+    uint32_t erased_end = start;
+    dirty_forget();
+    uint32_t erase_end  = (todo + FLASH_ERASE_SIZE - 1u) & ~(FLASH_ERASE_SIZE - 1u);
+    uint32_t want = (todo - start > FLASH_ERASE_SIZE) ? FLASH_ERASE_SIZE : (todo - start);
+    FSIZE_t  pos[2] = { 0, 0 };          // file offset each buffer's block came from
+    pos[cur] = f_tell(&f);
+    br = 0;
+    FRESULT rfr = restore_read(&src, buf[cur], (UINT)want, &br);
+
+    for (uint32_t base = start; base < todo; base += FLASH_ERASE_SIZE) {
+        if (rfr != FR_OK) {
+            printf("\r\nERROR: Read failed at 0x%06X (error %d)\r\n", base, rfr);
+            fr = rfr;
             break;
         }
         if (br == 0) {
@@ -278,37 +1916,81 @@ FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool ver
             fr = FR_INT_ERR;
             break;
         }
+        uint8_t *blk = buf[cur];
+        UINT     len = br;
 
-        // ERASE with web-safe wait
-        write_enable();
-        uint8_t cmd[4] = {0x20,(uint8_t)(base>>16),(uint8_t)(base>>8),(uint8_t)base};
-        cs_low(); 
-        spi_write_blocking(spi0, cmd, 4); 
-        cs_high();
-        wait_wip_clear_web_safe();  // Web-safe!
-
-        // PROGRAM in pages with web-safe wait
-        for (uint32_t off = 0; off < br; off += FLASH_PAGE_SIZE) {
-            uint32_t page_size = (br - off > FLASH_PAGE_SIZE) ? FLASH_PAGE_SIZE : (br - off);
-            
-            write_enable();
-            uint8_t hdr[4] = {0x02, (uint8_t)((base+off)>>16),(uint8_t)((base+off)>>8),(uint8_t)(base+off)};
-            cs_low(); 
-            spi_write_blocking(spi0, hdr, 4);
-            spi_write_blocking(spi0, &buf[off], page_size); 
-            cs_high();
-            wait_wip_clear_web_safe();  // Web-safe!
+        // ERASE (non-blocking) and prefetch the next block meanwhile
+        bool erasing = false;
+        int act = RESTORE_ERASE;
+        if (diff) {
+            read_data(base, rb, len);
+            act = restore_classify(blk, rb, len);
+            if (act == RESTORE_SAME) {
+                n_same++;
+            } else if (act == RESTORE_PROG) {
+                n_prog++;
+            } else if (!flash_op_submit_erase(base, FLASH_ERASE_SIZE, NULL, NULL)) {
+                printf("\r\nERROR: Could not start erase at 0x%06X\r\n", base);
+                fr = FR_INT_ERR;
+                break;
+            } else {
+                n_erase++;
+                erasing = true;
+                memset(rb, 0xFF, len);                  // what the sector holds next
+            }
+        } else if (base >= erased_end) {
+            uint32_t sz = flash_erase_plan_dirty(base, erase_end);
+            if (sz == 0) {
+                erased_end = base + FLASH_ERASE_SIZE;   // blank already
+            } else if (!flash_op_submit_erase(base, sz, NULL, NULL)) {
+                printf("\r\nERROR: Could not start erase at 0x%06X\r\n", base);
+                fr = FR_INT_ERR;
+                break;
+            } else {
+                erasing = true;
+                erased_end = base + sz;
+            }
+        }
+        uint32_t next = base + FLASH_ERASE_SIZE;
+        br = 0;
+        if (next < todo) {
+            want = (todo - next > FLASH_ERASE_SIZE) ? FLASH_ERASE_SIZE : (todo - next);
+            pos[cur ^ 1u] = f_tell(&f);
+            rfr = restore_read(&src, buf[cur ^ 1u], (UINT)want, &br);
+        }
+        if (erasing && flash_op_wait(false) != FLASH_OP_DONE) {  // Web-safe!
+            printf("\r\nERROR: Erase failed at 0x%06X\r\n", base);
+            fr = FR_INT_ERR;
+            break;
         }
 
-        // VERIFY
-        if (verify) {
-            read_data(base, rb, br);
-            if (memcmp(buf, rb, br) != 0) {
+        // PROGRAM, page-split and staged, with web-safe waits
+        bool prog_ok = true;
+        if (act == RESTORE_SAME) {
+            // nothing to do
+        } else if (diff) {
+            prog_ok = restore_program_changed(base, blk, rb, len, &n_pages);
+        } else if (flash_buf_is_blank(blk, len)) {
+            ff_blocks++;                                // erased flash already reads 0xFF
+        } else {
+            prog_ok = flash_write_stream(base, blk, len);
+        }
+        if (!prog_ok) {
+            printf("\r\nERROR: Program failed in block 0x%06X\r\n", base);
+            fr = FR_INT_ERR;
+            break;
+        }
+
+        // VERIFY (an untouched sector was just compared)
+        if (verify && act != RESTORE_SAME) {
+            if (flash_verify(base, blk, len) != 0) {
                 printf("\r\nERROR: VERIFY FAILED at 0x%06X\r\n", base);
                 fr = FR_INT_ERR;
                 break;
             }
         }
+        jnl_block_done(path, &j, base + len, flash_crc32_buf(blk, len), NULL, (uint32_t)pos[cur ^ 1u]);
+        cur ^= 1u;
 
         if ((base & ((256u * 1024u) - 1u)) == 0) {
             printf(".");
@@ -317,8 +1999,35 @@ FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool ver
     }
 
     printf("\r\n");
+    // an image larger than the chip was only restored up to flash_bytes
+    if (fr == FR_OK && src.packed && todo == hdr.image_bytes && j.chain != hdr.image_crc) {
+        printf("ERROR: Backup image CRC mismatch (blocks missing or out of order)\r\n");
+        fr = FR_INT_ERR;
+    }
+    // a restore done in pieces gets one end-to-end check against the chip
+    if (fr == FR_OK && resumed) {
+        if (flash_chain_crc(0, todo) != j.chain) {
+            printf("ERROR: Image CRC mismatch after resumed restore\r\n");
+            fr = FR_INT_ERR;
+        } else {
+            printf("Image CRC matches flash (%08X)\r\n", (unsigned)j.chain);
+        }
+    }
+    if (fr == FR_OK) jnl_clear(path);
     if (fr == FR_OK) {
-        printf("SUCCESS: Restore complete%s\r\n", verify ? " (verified)" : "");
+        printf("SUCCESS: Restore complete%s in %u ms\r\n", verify ? " (verified)" : "",
+               (unsigned)(absolute_time_diff_us(t_start, get_absolute_time()) / 1000));
+        if (diff) {
+            printf("Diff: %u sectors untouched, %u programmed without erase, %u erased + programmed "
+                   "(%u pages written)\r\n",
+                   (unsigned)n_same, (unsigned)n_prog, (unsigned)n_erase, (unsigned)n_pages);
+        } else {
+            flash_blank_stats_t bs = flash_blank_stats();
+            printf("Blank check: %u/%u sectors already blank, not erased (~%u ms saved, %u ms checking); "
+                   "%u blocks of 0xFF not programmed\r\n",
+                   (unsigned)bs.skipped, (unsigned)bs.checked, (unsigned)(bs.saved_us / 1000u),
+                   (unsigned)(bs.check_us / 1000u), (unsigned)ff_blocks);
+        }
         f_sync(&f);
     } else {
         printf("FAILED: Error code %d\r\n", fr);
@@ -327,4 +2036,161 @@ FRESULT flash_restore_from_file(const char *path, uint32_t flash_bytes, bool ver
     f_close(&f);
     f_unmount("0:");
     return fr;
+}
+
+// ========== COMPARE: check flash against an image, read-only ==========
+// Each 64K extent of the image is checked with one CRC streamed off the
+// chip against the CRC of the same span of the file (built block by block
+// as the file is read). Only an extent that differs is drilled into: its
+// 4K sectors are CRC'd on the chip against the per-sector CRCs kept from
+// the file pass, so the file is never read twice. Nothing is written.
+#define FLASH_CMP_EXTENT (64u * 1024u)
+#define FLASH_CMP_MAX_RUNS 32u        // differing ranges listed by the map
+
+static void cmp_mark(flash_cmp_result_t *res, uint32_t addr) {
+    uint32_t s = addr / FLASH_ERASE_SIZE;
+    res->sectors_differ++;
+    if (s < FLASH_CMP_MAP_SECTORS) res->map[s / 8u] |= (uint8_t)(1u << (s % 8u));
+}
+
+bool flash_cmp_sector_differs(const flash_cmp_result_t *res, uint32_t addr) {
+    uint32_t s = addr / FLASH_ERASE_SIZE;
+    return s < FLASH_CMP_MAP_SECTORS && (res->map[s / 8u] & (1u << (s % 8u))) != 0;
+}
+
+static void serial_out(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+FRESULT flash_compare_to_file(const char *path, uint32_t flash_bytes, flash_cmp_result_t *res) {
+    static uint8_t blk[FLASH_ERASE_SIZE];
+    uint32_t sec_crc[FLASH_CMP_EXTENT / FLASH_ERASE_SIZE];
+    FIL f;
+    FRESULT fr;
+    UINT br = 0;
+
+    memset(res, 0, sizeof *res);
+    fr = ensure_sd_and_folder();
+    if (fr != FR_OK) {
+        printf("ERROR: SD mount failed (error %d)\r\n", fr);
+        return fr;
+    }
+    fr = f_open(&f, path, FA_READ | FA_OPEN_EXISTING);
+    if (fr != FR_OK) {
+        printf("ERROR: File not found: %s (error %d)\r\n", path, fr);
+        f_unmount("0:");
+        return fr;
+    }
+
+    restore_src_t src = { .f = &f, .packed = false };
+    uint8_t hb[FPACK_HDR_BYTES];
+    fpack_hdr_t hdr;
+    uint32_t todo = (uint32_t)f_size(&f);
+    if (f_read(&f, hb, sizeof hb, &br) == FR_OK && br == sizeof hb && fpack_hdr_read(hb, &hdr)) {
+        src.packed = true;
+        todo = hdr.image_bytes;
+    } else {
+        f_lseek(&f, 0);
+    }
+    if (todo > flash_bytes) todo = flash_bytes;
+    printf("Comparing flash with %s (%u KB)...\r\n", path, (unsigned)(todo / 1024u));
+
+    absolute_time_t t_start = get_absolute_time();
+    uint32_t chain = FLASH_CRC32_SEED;
+    for (uint32_t base = 0; base < todo && fr == FR_OK; base += FLASH_CMP_EXTENT) {
+        uint32_t n = (todo - base > FLASH_CMP_EXTENT) ? FLASH_CMP_EXTENT : (todo - base);
+        uint32_t file_crc = FLASH_CRC32_SEED;
+        uint32_t got = 0;
+        for (uint32_t i = 0; got < n; i++) {
+            uint32_t want = (n - got > FLASH_ERASE_SIZE) ? FLASH_ERASE_SIZE : (n - got);
+            br = 0;
+            fr = restore_read(&src, blk, (UINT)want, &br);
+            if (fr == FR_OK && br == 0) fr = FR_INT_ERR;
+            if (fr != FR_OK) {
+                printf("\r\nERROR: Image read failed at 0x%06X (error %d)\r\n", (unsigned)(base + got), fr);
+                break;
+            }
+            sec_crc[i] = flash_crc32_buf(blk, br);
+            file_crc = crc32_buf_from(file_crc, blk, br);
+            chain = crc_chain(chain, sec_crc[i]);
+            got += br;
+        }
+        if (fr != FR_OK) break;
+
+        if (flash_crc32(base, got) != file_crc) {
+            res->extents_differ++;
+            for (uint32_t off = 0, i = 0; off < got; off += FLASH_ERASE_SIZE, i++) {
+                uint32_t len = (got - off > FLASH_ERASE_SIZE) ? FLASH_ERASE_SIZE : (got - off);
+                if (flash_crc32(base + off, len) != sec_crc[i]) cmp_mark(res, base + off);
+            }
+        }
+        res->bytes = base + got;
+
+        if ((base & ((256u * 1024u) - 1u)) == 0) {
+            printf(".");
+            fflush(stdout);
+        }
+    }
+    printf("\r\n");
+    res->elapsed_ms = (uint32_t)(absolute_time_diff_us(t_start, get_absolute_time()) / 1000);
+
+    if (fr == FR_OK && src.packed && todo == hdr.image_bytes && chain != hdr.image_crc) {
+        printf("ERROR: Backup image CRC mismatch (blocks missing or out of order)\r\n");
+        fr = FR_INT_ERR;
+    }
+    if (fr == FR_OK) flash_cmp_print_map(res, serial_out);
+
+    f_close(&f);
+    f_unmount("0:");
+    return fr;
+}
+
+// One column per 64K extent, 64 to a line (4 MB), then the differing
+// sectors merged into address ranges.
+void flash_cmp_print_map(const flash_cmp_result_t *res, flash_out_fn out) {
+    const uint32_t per_ext = FLASH_CMP_EXTENT / FLASH_ERASE_SIZE;
+    uint32_t sectors = (res->bytes + FLASH_ERASE_SIZE - 1u) / FLASH_ERASE_SIZE;
+
+    out("Compared %u KB in %u ms: %u of %u sectors differ (%u of %u 64K extents)\r\n",
+        (unsigned)(res->bytes / 1024u), (unsigned)res->elapsed_ms,
+        (unsigned)res->sectors_differ, (unsigned)sectors, (unsigned)res->extents_differ,
+        (unsigned)((res->bytes + FLASH_CMP_EXTENT - 1u) / FLASH_CMP_EXTENT));
+    if (res->sectors_differ == 0) {
+        out("Flash matches the image.\r\n");
+        return;
+    }
+
+    out("Map, one column per 64K ('.' same, 1-f sectors differing, '#' all 16):\r\n");
+    char line[65];
+    uint32_t col = 0, line_start = 0;
+    for (uint32_t s = 0; s < sectors; s += per_ext) {
+        if (col == 0) line_start = s;
+        uint32_t bad = 0;
+        for (uint32_t k = s; k < s + per_ext && k < sectors; k++)
+            if (flash_cmp_sector_differs(res, k * FLASH_ERASE_SIZE)) bad++;
+        char c = (s >= FLASH_CMP_MAP_SECTORS) ? '?' : (bad == 0) ? '.' : (bad >= per_ext) ? '#' : "0123456789abcdef"[bad];
+        line[col++] = c;
+        if (col == 64u || s + per_ext >= sectors) {
+            line[col] = '\0';
+            out("%06X %s\r\n", (unsigned)(line_start * FLASH_ERASE_SIZE), line);
+            col = 0;
+        }
+    }
+
+    uint32_t runs = 0;
+    for (uint32_t s = 0; s < sectors && s < FLASH_CMP_MAP_SECTORS; s++) {
+        if (!flash_cmp_sector_differs(res, s * FLASH_ERASE_SIZE)) continue;
+        uint32_t e = s;
+        while (e + 1u < sectors && flash_cmp_sector_differs(res, (e + 1u) * FLASH_ERASE_SIZE)) e++;
+        if (runs++ < FLASH_CMP_MAX_RUNS)
+            out("  %06X-%06X  %u KB\r\n", (unsigned)(s * FLASH_ERASE_SIZE),
+                (unsigned)((e + 1u) * FLASH_ERASE_SIZE - 1u), (unsigned)((e - s + 1u) * 4u));
+        s = e;
+    }
+    if (runs > FLASH_CMP_MAX_RUNS) out("  ... %u more ranges\r\n", (unsigned)(runs - FLASH_CMP_MAX_RUNS));
+    if (sectors > FLASH_CMP_MAP_SECTORS)
+        out("  (ranges cover the first %u MB only)\r\n", (unsigned)(FLASH_CMP_MAP_SECTORS * FLASH_ERASE_SIZE >> 20));
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "flash_pack.h"
+#include "flash.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH   3u
+#define LZ_MAX_MATCH   18u              // 4-bit length field
+#define LZ_HASH_BITS   10u
+#define RLE_MIN_RUN    3u
+#define RLE_MAX_RUN    130u             // control 0x80..0xFF
+#define RLE_MAX_LIT    128u             // control 0x00..0x7F
+
+static uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static void put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+// ---------------- header / records ----------------
+
+void fpack_hdr_write(const fpack_hdr_t *h, uint8_t out[FPACK_HDR_BYTES]) {
+    memset(out, 0, FPACK_HDR_BYTES);
+    memcpy(out, FPACK_MAGIC, 4);
+    put16(out + 4, FPACK_VERSION);
+    put16(out + 6, FPACK_HDR_BYTES);
+    memcpy(out + 8, h->jedec, 3);
+    put32(out + 12, h->capacity);
+    put32(out + 16, h->image_bytes);
+    put32(out + 20, h->block_bytes);
+    put32(out + 24, h->image_crc);
+    put32(out + 28, flash_crc32_sw(FLASH_CRC32_SEED, out, 28));
+}
+
+bool fpack_hdr_read(const uint8_t in[FPACK_HDR_BYTES], fpack_hdr_t *h) {
+    if (memcmp(in, FPACK_MAGIC, 4) != 0) return false;
+    if (le16(in + 4) != FPACK_VERSION || le16(in + 6) != FPACK_HDR_BYTES) return false;
+    if (le32(in + 28) != flash_crc32_sw(FLASH_CRC32_SEED, in, 28)) return false;
+    memcpy(h->jedec, in + 8, 3);
+    h->capacity    = le32(in + 12);
+    h->image_bytes = le32(in + 16);
+    h->block_bytes = le32(in + 20);
+    h->image_crc   = le32(in + 24);
+    return h->block_bytes == FPACK_BLOCK;
+}
+
+void fpack_rec_write(const fpack_rec_t *r, uint8_t out[FPACK_REC_BYTES]) {
+    out[0] = r->enc;
+    out[1] = 0;
+    put16(out + 2, r->len);
+    put32(out + 4, r->crc);
+}
+
+void fpack_rec_read(const uint8_t in[FPACK_REC_BYTES], fpack_rec_t *r) {
+    r->enc = in[0];
+    r->len = le16(in + 2);
+    r->crc = le32(in + 4);
+}
+
+// ---------------- PackBits RLE ----------------
+// Control byte c: 0..127 -> c+1 literal bytes follow; 128..255 -> the next
+// byte repeats c-125 times (3..130). Returns 0 once it would reach 'cap'.
+
+static uint32_t rle_encode(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t cap) {
+    uint32_t i = 0, o = 0, lit = 0;     // lit: start of the pending literal run
+    while (i < len) {
+        uint32_t run = 1;
+        while (i + run < len && run < RLE_MAX_RUN && in[i + run] == in[i]) run++;
+        if (run < RLE_MIN_RUN && i + 1 < len) { i++; continue; }
+        if (run < RLE_MIN_RUN) i = len;          // tail byte joins the literals
+        // flush literals [lit, i)
+        while (lit < i) {
+            uint32_t n = i - lit;
+            if (n > RLE_MAX_LIT) n = RLE_MAX_LIT;
+            if (o + 1u + n >= cap) return 0;
+            out[o++] = (uint8_t)(n - 1u);
+            memcpy(out + o, in + lit, n);
+            o += n; lit += n;
+        }
+        if (run >= RLE_MIN_RUN) {
+            if (o + 2u >= cap) return 0;
+            out[o++] = (uint8_t)(run + 125u);
+            out[o++] = in[i];
+            i += run; lit = i;
+        }
+    }
+    return o;
+}
+
+static bool rle_decode(const uint8_t *in, uint32_t in_len, uint8_t *out, uint32_t out_len) {
+    uint32_t i = 0, o = 0;
+    while (i < in_len) {
+        uint8_t c = in[i++];
+        if (c < 0x80u) {
+            uint32_t n = c + 1u;
+            if (i + n > in_len || o + n > out_len) return false;
+            memcpy(out + o, in + i, n);
+            i += n; o += n;
+        } else {
+            uint32_t n = c - 125u;
+            if (i >= in_len || o + n > out_len) return false;
+            memset(out + o, in[i++], n);
+            o += n;
+        }
+    }
+    return o == out_len;
+}
+
+// ---------------- LZSS ----------------
+// A flag byte covers the next 8 items, LSB first: 0 = literal byte,
+// 1 = match of 2 bytes: [15:4] distance-1, [3:0] length-3. One candidate
+// per 3-byte hash keeps it to a single pass.
+
+static uint32_t lz_hash(const uint8_t *p) {
+    return ((uint32_t)p[0] * 2654435761u ^ (uint32_t)p[1] * 40503u ^ p[2]) & ((1u << LZ_HASH_BITS) - 1u);
+}
+
+static uint32_t lz_encode(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t cap) {
+    static uint16_t head[1u << LZ_HASH_BITS];    // position + 1 of the last sighting
+    memset(head, 0, sizeof head);
+    uint32_t i = 0, o = 0, flag_at = 0, item = 8;
+    while (i < len) {
+        if (item == 8) {
+            if (o + 1u + 2u * 8u >= cap) return 0;   // room for a whole group
+            flag_at = o; out[o++] = 0; item = 0;
+        }
+        uint32_t best = 0, dist = 0;
+        if (i + LZ_MIN_MATCH <= len) {
+            uint32_t h = lz_hash(in + i);
+            if (head[h]) {
+                uint32_t cand = head[h] - 1u;
+                uint32_t max = len - i;
+                if (max > LZ_MAX_MATCH) max = LZ_MAX_MATCH;
+                while (best < max && in[cand + best] == in[i + best]) best++;
+                dist = i - cand;
+            }
+            head[h] = (uint16_t)(i + 1u);
+        }
+        if (best >= LZ_MIN_MATCH) {
+            uint16_t tok = (uint16_t)(((dist - 1u) << 4) | (best - LZ_MIN_MATCH));
+            out[flag_at] |= (uint8_t)(1u << item);
+            out[o++] = (uint8_t)(tok >> 8);
+            out[o++] = (uint8_t)tok;
+            for (uint32_t k = 1; k < best && i + k + LZ_MIN_MATCH <= len; k++)
+                head[lz_hash(in + i + k)] = (uint16_t)(i + k + 1u);
+            i += best;
+        } else {
+            out[o++] = in[i++];
+        }
+        item++;
+    }
+    return o;
+}
+
+static bool lz_decode(const uint8_t *in, uint32_t in_len, uint8_t *out, uint32_t out_len) {
+    uint32_t i = 0, o = 0;
+    while (i < in_len) {
+        uint8_t flags = in[i++];
+        for (int item = 0; item < 8 && i < in_len; item++) {
+            if (flags & (1u << item)) {
+                if (i + 2u > in_len) return false;
+                uint16_t tok = (uint16_t)((in[i] << 8) | in[i + 1]);
+                i += 2;
+                uint32_t dist = (tok >> 4) + 1u, n = (tok & 0xFu) + LZ_MIN_MATCH;
+                if (dist > o || o + n > out_len) return false;
+                for (uint32_t k = 0; k < n; k++, o++) out[o] = out[o - dist];   // may overlap
+            } else {
+                if (o >= out_len) return false;
+                out[o++] = in[i++];
+            }
+        }
+    }
+    return o == out_len;
+}
+
+// ---------------- block codec ----------------
+
+uint32_t fpack_encode(const uint8_t *blk, uint32_t len, uint8_t *out, fpack_enc_t *enc) {
+    if (flash_buf_is_blank(blk, len)) { *enc = FPACK_ERASED; return 0; }
+
+    // RLE first: cheap, and unbeatable on padding. LZ only has to beat it.
+    static uint8_t alt[FPACK_BLOCK];
+    uint32_t best = len;
+    *enc = FPACK_RAW;
+    uint32_t n = rle_encode(blk, len, out, best);
+    if (n) { best = n; *enc = FPACK_RLE; }
+    n = lz_encode(blk, len, alt, best);
+    if (n) { best = n; *enc = FPACK_LZ; memcpy(out, alt, n); }
+    if (*enc == FPACK_RAW) memcpy(out, blk, len);
+    return best;
+}
+
+bool fpack_decode(fpack_enc_t enc, const uint8_t *in, uint32_t in_len,
+                  uint8_t *out, uint32_t out_len) {
+    switch (enc) {
+    case FPACK_ERASED: memset(out, 0xFF, out_len); return in_len == 0;
+    case FPACK_RLE:    return rle_decode(in, in_len, out, out_len);
+    case FPACK_LZ:     return lz_decode(in, in_len, out, out_len);
+    case FPACK_RAW:
+        if (in_len != out_len) return false;
+        memcpy(out, in, out_len);
+        return true;
+    }
+    return false;
+}
+
+const char *fpack_enc_name(fpack_enc_t enc) {
+    static const char *const names[] = { "erased", "rle", "lz", "raw" };
+    return (unsigned)enc < 4u ? names[enc] : "?";
+}
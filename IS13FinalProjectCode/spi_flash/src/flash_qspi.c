@@ -0,0 +1,202 @@
+#include "flash_qspi.h"
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "config.h"
+#include "flash_qspi.pio.h"
+
+#if PIN_MISO != PIN_MOSI + 1
+#error "PIO reads need MISO (IO1) on the GPIO right after MOSI (IO0)"
+#endif
+#if FLASH_QUAD_WIRED && (PIN_CS == PIN_IO2 || PIN_CS == PIN_IO3 || PIN_SCK == PIN_IO2 || PIN_SCK == PIN_IO3)
+#error "FLASH_QUAD_WIRED: IO2/IO3 overlap CS or SCK"
+#endif
+
+#define PIN_IO0        PIN_MOSI
+#define QIO_MODE_BYTE  0xFFu     // anything but the continuous-read pattern (Winbond 0x2x, ISSI 0xAx)
+
+static PIO  s_pio = NULL;
+static int  s_sm  = -1;
+static int  s_dma = -1;
+static uint s_off_dual = 0;
+static uint s_off_quad = 0;
+static dma_channel_config s_dma_cfg;
+
+bool flash_qspi_init(void) {
+    if (s_dma >= 0) return true;
+
+    // cyw43 takes a PIO too; use whichever one still has room for both programs
+    PIO pios[2] = { pio0, pio1 };
+    for (int i = 0; i < 2 && !s_pio; i++) {
+        PIO p = pios[i];
+        if (!pio_can_add_program(p, &flash_dual_read_program)) continue;
+        uint off_dual = pio_add_program(p, &flash_dual_read_program);
+        if (!pio_can_add_program(p, &flash_quad_read_program)) {
+            pio_remove_program(p, &flash_dual_read_program, off_dual);
+            continue;
+        }
+        int sm = pio_claim_unused_sm(p, false);
+        if (sm < 0) {
+            pio_remove_program(p, &flash_dual_read_program, off_dual);
+            continue;
+        }
+        s_off_dual = off_dual;
+        s_off_quad = pio_add_program(p, &flash_quad_read_program);
+        s_sm  = sm;
+        s_pio = p;
+    }
+    if (!s_pio) {
+        printf("PIO read: no free state machine / instruction space\r\n");
+        return false;
+    }
+
+    s_dma = dma_claim_unused_channel(false);
+    if (s_dma < 0) {
+        printf("PIO read: no free DMA channel\r\n");
+        return false;
+    }
+    s_dma_cfg = dma_channel_get_default_config((uint)s_dma);
+    channel_config_set_transfer_data_size(&s_dma_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&s_dma_cfg, false);
+    channel_config_set_write_increment(&s_dma_cfg, true);
+    channel_config_set_dreq(&s_dma_cfg, pio_get_dreq(s_pio, (uint)s_sm, false));
+
+#if FLASH_QUAD_WIRED
+    // WP#/HOLD# idle high between quad transfers
+    gpio_init(PIN_IO2); gpio_pull_up(PIN_IO2);
+    gpio_init(PIN_IO3); gpio_pull_up(PIN_IO3);
+#endif
+    return true;
+}
+
+bool flash_quad_enable(void) {
+    uint8_t id[3];
+    read_jedec_id(id);
+    uint8_t sr1 = read_status(0x05);
+    // ISSI and Macronix keep QE in SR1 bit 6; Winbond, GigaDevice, Adesto
+    // and SST26 (IOC) use bit 1 of the second status/config register, which
+    // they all accept as the second byte of WRSR.
+    bool qe_in_sr1 = (id[0] == 0x9D || id[0] == 0xC2);
+    // SFDP DWORD 15 says so directly: 0 = no QE bit, 2 = SR1 bit 6,
+    // 1/4/5 = SR2 bit 1; other layouts keep the vendor guess.
+    const sfdp_info_t *sf = flash_sfdp();
+    if (sf && sf->has_qe_req) {
+        if (sf->qe_req == 0) return true;
+        if (sf->qe_req == 2) qe_in_sr1 = true;
+        else if (sf->qe_req == 1 || sf->qe_req == 4 || sf->qe_req == 5) qe_in_sr1 = false;
+    }
+
+    if (qe_in_sr1) {
+        if (sr1 & 0x40) return true;
+        uint8_t cmd[2] = { 0x01, (uint8_t)(sr1 | 0x40) };
+        write_enable();
+        cs_low(); spi_write_blocking(flash_spi(), cmd, 2); cs_high();
+    } else {
+        uint8_t sr2 = read_status(0x35);
+        if (sr2 & 0x02) return true;
+        uint8_t cmd[3] = { 0x01, sr1, (uint8_t)(sr2 | 0x02) };
+        write_enable();
+        cs_low(); spi_write_blocking(flash_spi(), cmd, 3); cs_high();
+    }
+    if (!wait_wip_clear()) return false;
+
+    bool ok = qe_in_sr1 ? (read_status(0x05) & 0x40) != 0
+                        : (read_status(0x35) & 0x02) != 0;
+    if (!ok) printf("Quad enable failed (JEDEC %02X %02X %02X)\r\n", id[0], id[1], id[2]);
+    return ok;
+}
+
+bool flash_qspi_prepare(flash_read_mode_t mode) {
+    if (mode == FLASH_READ_1_1_1) return true;
+    if (!flash_qspi_init()) return false;
+    if (mode == FLASH_READ_1_1_2) return true;      // dual output needs no setup
+#if FLASH_QUAD_WIRED
+    // the PIO address phase is 24-bit only
+    if (mode == FLASH_READ_1_4_4 && flash_addr_bytes() != 3) return false;
+    return flash_quad_enable();
+#else
+    return false;
+#endif
+}
+
+static void pins_to_pio(uint lanes) {
+    uint32_t sck  = 1u << PIN_SCK;
+    uint32_t data = ((1u << lanes) - 1u) << PIN_IO0;
+    pio_sm_set_pins_with_mask(s_pio, (uint)s_sm, 0, sck);            // SCK idles low (mode 0)
+    pio_sm_set_pindirs_with_mask(s_pio, (uint)s_sm, sck, sck | data);
+    pio_gpio_init(s_pio, PIN_SCK);
+    for (uint i = 0; i < lanes; i++) pio_gpio_init(s_pio, PIN_IO0 + i);
+}
+
+static void pins_to_spi(uint lanes) {
+    gpio_set_function(PIN_SCK,  GPIO_FUNC_SPI);
+    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
+    if (lanes == 4) {
+        gpio_set_function(PIN_IO2, GPIO_FUNC_SIO);
+        gpio_set_function(PIN_IO3, GPIO_FUNC_SIO);
+    }
+}
+
+void flash_qspi_read(flash_read_mode_t mode, uint32_t addr, uint8_t *buf, uint32_t len) {
+    if (!len) return;
+    bool quad  = (mode != FLASH_READ_1_1_2);
+    uint lanes = quad ? 4u : 2u;
+    bool op4   = flash_uses_4byte_opcodes();
+
+    uint8_t hdr[6];
+    uint32_t n = 0;
+    switch (mode) {
+        case FLASH_READ_1_1_2: hdr[n++] = op4 ? 0x3C : 0x3B; break;
+        case FLASH_READ_1_1_4: hdr[n++] = op4 ? 0x6C : 0x6B; break;
+        default:               hdr[n++] = 0xEB;              break;
+    }
+    if (mode != FLASH_READ_1_4_4) {
+        if (flash_addr_bytes() == 4) hdr[n++] = (uint8_t)(addr >> 24);
+        hdr[n++] = (uint8_t)(addr >> 16);
+        hdr[n++] = (uint8_t)(addr >> 8);
+        hdr[n++] = (uint8_t)addr;
+        hdr[n++] = 0x00;                             // 8 dummy clocks
+    }
+
+    // both programs park on the 'out' at their wrap target when done
+    uint idle  = quad ? s_off_quad + flash_quad_read_offset_data : s_off_dual;
+    uint entry = (mode == FLASH_READ_1_4_4) ? s_off_quad + flash_quad_read_offset_io : idle;
+
+    pio_sm_config c = quad ? flash_quad_read_program_get_default_config(s_off_quad)
+                           : flash_dual_read_program_get_default_config(s_off_dual);
+    sm_config_set_sideset_pins(&c, PIN_SCK);
+    sm_config_set_in_pins(&c, PIN_IO0);
+    sm_config_set_out_pins(&c, PIN_IO0, 4);
+    sm_config_set_set_pins(&c, PIN_IO0, 4);
+    sm_config_set_in_shift(&c, false, true, 8);
+    sm_config_set_out_shift(&c, false, true, 32);
+    // two instructions per SCK; below clkdiv 2 the input sample lands too close to the edge
+    float div = (float)clock_get_hz(clk_sys) / (2.0f * (float)spi_get_baudrate(flash_spi()));
+    if (div < 2.0f) div = 2.0f;
+    sm_config_set_clkdiv(&c, div);
+    pio_sm_init(s_pio, (uint)s_sm, entry, &c);
+
+    cs_low();
+    spi_write_blocking(flash_spi(), hdr, n);
+    pins_to_pio(lanes);
+
+    dma_channel_configure((uint)s_dma, &s_dma_cfg, buf, &s_pio->rxf[s_sm], len, true);
+    if (mode == FLASH_READ_1_4_4) {
+        pio_sm_put(s_pio, (uint)s_sm, (addr << 8) | QIO_MODE_BYTE);
+        // wait states left after the 2 clocks of the mode byte (SFDP DWORD 3)
+        pio_sm_put(s_pio, (uint)s_sm, flash_read_wait_clocks(FLASH_READ_1_4_4) - 3u);
+    }
+    pio_sm_put(s_pio, (uint)s_sm, len * (8u / lanes) - 1u);
+    pio_sm_set_enabled(s_pio, (uint)s_sm, true);
+
+    dma_channel_wait_for_finish_blocking((uint)s_dma);
+    // let the trailing clock finish before SCK goes back to the SPI block
+    while (pio_sm_get_pc(s_pio, (uint)s_sm) != idle) { tight_loop_contents(); }
+    pio_sm_set_enabled(s_pio, (uint)s_sm, false);
+
+    pins_to_spi(lanes);
+    cs_high();
+}
@@ -0,0 +1,181 @@
+#include "sfdp.h"
+#include "flash.h"
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SFDP_SIGNATURE   0x50444653u   // "SFDP", little-endian
+#define SFDP_ID_BFPT     0xFF00u
+#define SFDP_ID_4BAIT    0xFF84u
+#define BFPT_MAX_DWORDS  16u           // JESD216B; later revisions only append
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void sfdp_read(uint32_t addr, uint8_t *buf, uint32_t len) {
+    uint8_t cmd[5] = { 0x5A, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr, 0x00 };
+    cs_low(); spi_write_blocking(flash_spi(), cmd, 5);
+    spi_read_blocking(flash_spi(), 0x00, buf, (int)len); cs_high();
+}
+
+// DWORD 3/4 fast-read halves: [4:0] wait states, [7:5] mode clocks, [15:8] opcode
+static sfdp_read_t read_params(bool supported, uint16_t f) {
+    sfdp_read_t r = { supported, (uint8_t)(f >> 8), (uint8_t)(f & 0x1Fu), (uint8_t)((f >> 5) & 0x7u) };
+    return r;
+}
+
+// 7-bit erase time field: [6:5] units (1 ms, 16 ms, 128 ms, 1 s), [4:0] count-1
+static uint32_t erase_time_us(uint32_t f) {
+    static const uint32_t unit_us[4] = { 1000u, 16000u, 128000u, 1000000u };
+    return ((f & 0x1Fu) + 1u) * unit_us[(f >> 5) & 3u];
+}
+
+bool sfdp_parse(sfdp_info_t *out) {
+    memset(out, 0, sizeof *out);
+
+    uint8_t hdr[8];
+    sfdp_read(0, hdr, sizeof hdr);
+    if (le32(hdr) != SFDP_SIGNATURE) return false;
+
+    uint32_t nph = (uint32_t)hdr[6] + 1u;
+    if (nph > 16u) nph = 16u;                   // garbage guard
+
+    uint32_t bfpt_ptr = 0, bfpt_len = 0, bait_ptr = 0, bait_len = 0;
+    for (uint32_t i = 0; i < nph; i++) {
+        uint8_t ph[8];
+        sfdp_read(8u + 8u * i, ph, sizeof ph);
+        uint16_t id  = (uint16_t)((ph[7] << 8) | ph[0]);
+        uint32_t len = ph[3];                   // in DWORDs
+        uint32_t ptr = (uint32_t)ph[4] | ((uint32_t)ph[5] << 8) | ((uint32_t)ph[6] << 16);
+        if (id == SFDP_ID_BFPT && !bfpt_ptr) {
+            bfpt_ptr = ptr; bfpt_len = len;
+            out->rev_major = ph[2]; out->rev_minor = ph[1];
+        } else if (id == SFDP_ID_4BAIT && !bait_ptr) {
+            bait_ptr = ptr; bait_len = len;
+        }
+    }
+    if (!bfpt_ptr || bfpt_len < 9u) return false;   // rev 0 tables are 9 DWORDs
+    if (bfpt_len > BFPT_MAX_DWORDS) bfpt_len = BFPT_MAX_DWORDS;
+
+    uint8_t raw[BFPT_MAX_DWORDS * 4u];
+    sfdp_read(bfpt_ptr, raw, bfpt_len * 4u);
+    uint32_t dw[BFPT_MAX_DWORDS + 1u] = {0};        // 1-based, like the spec
+    for (uint32_t i = 0; i < bfpt_len; i++) dw[i + 1u] = le32(&raw[i * 4u]);
+    out->bfpt_dwords = (uint8_t)bfpt_len;
+
+    // DWORD 1: address bytes, which fast reads exist
+    out->addr_mode = (uint8_t)((dw[1] >> 17) & 0x3u);
+    // DWORD 2: density in bits, or 2^N bits when bit 31 is set
+    if (dw[2] & 0x80000000u) {
+        uint32_t n = dw[2] & 0x7FFFFFFFu;
+        out->density_bytes = (n >= 3u && n < 35u) ? (1u << (n - 3u)) : 0u;
+    } else {
+        out->density_bytes = (dw[2] + 1u) / 8u;
+    }
+    // DWORD 3/4: 1-4-4 | 1-1-4, 1-1-2 | 1-2-2
+    out->read_144 = read_params((dw[1] >> 21) & 1u, (uint16_t)dw[3]);
+    out->read_114 = read_params((dw[1] >> 22) & 1u, (uint16_t)(dw[3] >> 16));
+    out->read_112 = read_params((dw[1] >> 16) & 1u, (uint16_t)dw[4]);
+    out->read_122 = read_params((dw[1] >> 20) & 1u, (uint16_t)(dw[4] >> 16));
+
+    // DWORD 8/9: erase types as (2^N size, opcode) pairs
+    for (uint32_t t = 0; t < 4u; t++) {
+        uint32_t f = (dw[8u + t / 2u] >> ((t & 1u) * 16u)) & 0xFFFFu;
+        uint8_t  n = (uint8_t)f;
+        if (n == 0u || n > 31u) continue;
+        out->erase[t].size   = 1u << n;
+        out->erase[t].opcode = (uint8_t)(f >> 8);
+    }
+
+    // DWORD 10: typical erase times, max = 2 * (mult + 1) * typ
+    if (bfpt_len >= 10u) {
+        uint32_t mult = (dw[10] & 0xFu) + 1u;
+        for (uint32_t t = 0; t < 4u; t++) {
+            if (!out->erase[t].size) continue;
+            out->erase[t].typ_us = erase_time_us(dw[10] >> (4u + 7u * t));
+            out->erase[t].max_us = 2u * mult * out->erase[t].typ_us;
+        }
+    }
+
+    // DWORD 11: page size, page program and chip erase times
+    out->page_size = 256u;
+    if (bfpt_len >= 11u) {
+        uint32_t mult = (dw[11] & 0xFu) + 1u;
+        out->page_size = 1u << ((dw[11] >> 4) & 0xFu);
+        uint32_t pp = (dw[11] >> 8) & 0x3Fu;
+        out->prog_typ_us = ((pp & 0x1Fu) + 1u) * ((pp & 0x20u) ? 64u : 8u);
+        out->prog_max_us = 2u * mult * out->prog_typ_us;
+        static const uint32_t chip_unit_ms[4] = { 16u, 256u, 4000u, 64000u };
+        uint32_t ce = (dw[11] >> 24) & 0x7Fu;
+        uint64_t chip_us = (uint64_t)((ce & 0x1Fu) + 1u) * chip_unit_ms[(ce >> 5) & 3u] * 1000u;
+        out->chip_typ_us = chip_us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)chip_us;
+        chip_us *= 2u * mult;
+        out->chip_max_us = chip_us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)chip_us;
+    }
+
+    // DWORD 12: suspend latencies and resume-to-suspend gaps (bit 31 set =
+    // no suspend); DWORD 13: the suspend/resume opcodes
+    if (bfpt_len >= 13u && !(dw[12] & 0x80000000u)) {
+        static const uint32_t lat_ns[4] = { 128u, 1000u, 8000u, 64000u };
+        out->has_suspend = true;
+        out->erase_suspend_us = (((dw[12] >> 24) & 0x1Fu) + 1u) * lat_ns[(dw[12] >> 29) & 3u] / 1000u + 1u;
+        out->prog_suspend_us  = (((dw[12] >> 13) & 0x1Fu) + 1u) * lat_ns[(dw[12] >> 18) & 3u] / 1000u + 1u;
+        out->erase_resume_gap_us = (((dw[12] >> 20) & 0xFu) + 1u) * 64u;
+        out->prog_resume_gap_us  = (((dw[12] >> 9) & 0xFu) + 1u) * 64u;
+        out->prog_resume_op   = (uint8_t)dw[13];
+        out->prog_suspend_op  = (uint8_t)(dw[13] >> 8);
+        out->erase_resume_op  = (uint8_t)(dw[13] >> 16);
+        out->erase_suspend_op = (uint8_t)(dw[13] >> 24);
+    }
+
+    // DWORD 15: how to set QE; DWORD 16: how to enter 4-byte mode
+    if (bfpt_len >= 15u) {
+        out->has_qe_req = true;
+        out->qe_req = (uint8_t)((dw[15] >> 20) & 0x7u);
+    }
+    if (bfpt_len >= 16u) out->enter_4b = (uint8_t)(dw[16] >> 24);
+
+    // 4BAIT: DWORD 1 support bits, DWORD 2 one 4-byte erase opcode per type
+    if (bait_ptr && bait_len >= 2u) {
+        uint8_t b[8];
+        sfdp_read(bait_ptr, b, sizeof b);
+        out->has_4bait = true;
+        out->bait_support = le32(&b[0]);
+        for (uint32_t t = 0; t < 4u; t++) {
+            if (out->erase[t].size && (out->bait_support & (1u << (9u + t))))
+                out->erase[t].opcode_4b = b[4u + t];
+        }
+    }
+    return true;
+}
+
+void sfdp_print(const sfdp_info_t *s) {
+    static const char *const addr[4] = { "3", "3/4", "4", "?" };
+    printf("SFDP BFPT v%u.%u (%u DWORDs): %lu KB, %s-byte addr, page %lu B\r\n",
+           s->rev_major, s->rev_minor, s->bfpt_dwords,
+           (unsigned long)(s->density_bytes / 1024u), addr[s->addr_mode & 3u],
+           (unsigned long)s->page_size);
+    for (int t = 0; t < 4; t++) {
+        if (!s->erase[t].size) continue;
+        printf("  erase %luK op %02X  typ %lu ms  max %lu ms\r\n",
+               (unsigned long)(s->erase[t].size / 1024u), s->erase[t].opcode,
+               (unsigned long)(s->erase[t].typ_us / 1000u), (unsigned long)(s->erase[t].max_us / 1000u));
+    }
+    const sfdp_read_t *r[4] = { &s->read_112, &s->read_122, &s->read_114, &s->read_144 };
+    const char *name[4] = { "1-1-2", "1-2-2", "1-1-4", "1-4-4" };
+    for (int i = 0; i < 4; i++) {
+        if (!r[i]->supported) continue;
+        printf("  read %s op %02X  %u mode + %u dummy clocks\r\n",
+               name[i], r[i]->opcode, r[i]->mode_clocks, r[i]->dummy_clocks);
+    }
+    if (s->has_suspend)
+        printf("  suspend erase %02X/%02X (%lu us)  program %02X/%02X (%lu us)\r\n",
+               s->erase_suspend_op, s->erase_resume_op, (unsigned long)s->erase_suspend_us,
+               s->prog_suspend_op, s->prog_resume_op, (unsigned long)s->prog_suspend_us);
+    if (s->prog_typ_us)
+        printf("  page program typ %lu us  max %lu us; chip erase typ %lu ms\r\n",
+               (unsigned long)s->prog_typ_us, (unsigned long)s->prog_max_us,
+               (unsigned long)(s->chip_typ_us / 1000u));
+}
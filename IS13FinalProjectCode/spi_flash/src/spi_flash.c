@@ -17,6 +17,7 @@
 #include "ui.h"
 #include "net.h"
 #include "http_server.h"
+#include "clock_tune.h"
 #include "config.h"
 
 /* =================== MAIN =================== */
@@ -27,17 +28,23 @@ int main(void) {
     for (int i = 0; i < 5000 && !stdio_usb_connected(); ++i) sleep_ms(1);
     sleep_ms(200);
 
-    // Init SPI (flash)
-    spi_init(spi0, SPI_FREQ_HZ);
-    spi_set_format(spi0, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
-
-    gpio_set_function(PIN_SCK,  GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
+    // Init SPI (flash): one device per FLASH_CS_PINS entry
+    flash_init_spi(SPI_FREQ_HZ);
+
+    for (unsigned i = 0; i < flash_dev_count(); i++) {
+        flash_dev_select(flash_dev_get(i));
+        // Select Fast Read / 4-byte addressing for the fitted part
+        if (!flash_probe()) continue;
+        // Seed the WIP poller with this part's datasheet times (spichips.csv on SD)
+        chip_ref_seed_timing();
+        // Run at the ceiling 't' found for this part last time, if any
+        uint32_t hz = clock_tune_apply();
+        if (hz) printf("CS=GP%u: tuned clock %u Hz\r\n", flash_dev_cs_pin(NULL), (unsigned)hz);
+    }
+    flash_dev_select(flash_dev_get(0));
 
-    gpio_init(PIN_CS);
-    gpio_set_dir(PIN_CS, GPIO_OUT);
-    cs_high();
+    // Core 1 waits for the web "Run Benchmark" button (bench_core.c)
+    init_benchmark_core();
 
      // 1) Bring up Wi-Fi (but do NOT block forever)
     wifi_init_default();
@@ -56,6 +63,17 @@ int main(void) {
         int c = get_choice_blocking();
         printf("%c\r\n", c);
 
+        // Hold the flash bus for the whole action, so a web request can't
+        // start core 1 (or its own action) underneath it
+        if (c != 'q' && c != 'Q' && !flash_bus_acquire(FLASH_BUS_SERIAL)) {
+            if (flash_bus_owner() == FLASH_BUS_CORE1)
+                printf("Background benchmark running on core 1 (%d%%); try again shortly.\r\n",
+                       get_benchmark_progress());
+            else
+                printf("Flash busy with a web action; try again shortly.\r\n");
+            continue;
+        }
+
         switch (c) {
             case '1':
                 // Run benchmarks, log to serial
@@ -109,8 +127,8 @@ int main(void) {
            case 'b':                                 
            case 'B': {
                 printf("\r\n=== Backup Flash to SD ===\r\n");
-                printf("Backing up 4MB flash to SD card...\r\n");
-                FRESULT fr = flash_backup_to_file("0:/pico_test/flash_backup.bin", FLASH_SIZE_BYTES);
+                printf("Backing up %uKB flash to SD card...\r\n", (unsigned)(flash_capacity_bytes() / 1024u));
+                FRESULT fr = flash_backup_to_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), FLASH_BACKUP_COMPRESS);
                 if (fr == FR_OK) {
                     printf("Backup successful!\r\n");
                 } else {
@@ -124,7 +142,7 @@ int main(void) {
                 printf("\r\n=== Restore Flash from SD ===\r\n");
                 printf("WARNING: This will OVERWRITE your flash chip!\r\n");
                 printf("Restoring flash from SD card...\r\n");
-                FRESULT fr = flash_restore_from_file("0:/pico_test/flash_backup.bin", FLASH_SIZE_BYTES, true);
+                FRESULT fr = flash_restore_from_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), true, true);
                 if (fr == FR_OK) {
                     printf("Restore successful!\r\n");
                 } else {
@@ -133,6 +151,58 @@ int main(void) {
                 break;
             }
 
+            case 'v':
+            case 'V':
+                action_verify_flash();
+                break;
+
+            case 't':
+            case 'T':
+                action_tune_clock();
+                break;
+
+            case 'm':
+            case 'M': {
+                // Benchmark every chip select and save, same as '3'
+                FRESULT fr = csv_begin();
+                if (fr != FR_OK) {
+                    printf("CSV logging disabled.\r\n");
+                } else {
+                    csv_mark_session_start();
+                    run_benchmarks_all_devices(N_TRIALS, true, true);
+                    csv_end();
+                }
+                break;
+            }
+
+            case 'p':
+            case 'P': {
+                // Workload from the card; writes a template first time round
+                FRESULT fr = csv_begin();
+                if (fr != FR_OK) {
+                    printf("CSV logging disabled.\r\n");
+                } else {
+                    csv_mark_session_start();
+                    run_benchmark_plan_file("custom", N_TRIALS, true, true);
+                    csv_end();
+                }
+                break;
+            }
+
+            case 'c':
+            case 'C': {
+                // Loader chunk sizing: one results.csv row per transfer size
+                FRESULT fr = csv_begin();
+                if (fr != FR_OK) {
+                    printf("CSV logging disabled.\r\n");
+                } else {
+                    csv_mark_session_start();
+                    run_read_curve(true);
+                    csv_end();
+                }
+                break;
+            }
+
             case 'q':
             case 'Q':
                 printf("Exiting menu. Reset board to reopen.\r\n");
@@ -142,6 +212,7 @@ int main(void) {
                 printf("Unknown choice. Try again.\r\n");
                 break;
         }
+        flash_bus_release(FLASH_BUS_SERIAL);
         
     }
 
@@ -1,6 +1,8 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include "pico/stdlib.h"
 #include "ui.h"
+#include "clock_tune.h"
 #include "net.h"
 #include "http_server.h"
 #include "flash.h"
@@ -18,9 +20,9 @@ int get_choice_blocking(void) {
 
 void action_backup_flash(void) {
     printf("\r\n=== Backup SPI Flash ===\r\n");
-    FRESULT fr = flash_backup_to_file("0:/pico_test/flash_backup.bin", FLASH_TOTAL_BYTES);
+    FRESULT fr = flash_backup_to_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), FLASH_BACKUP_COMPRESS);
     if (fr == FR_OK) {
-        printf("Backup OK -> 0:/pico_test/flash_backup.bin\r\n");
+        printf("Backup OK -> %s\r\n", FLASH_BACKUP_PATH);
     } else {
         printf("ERROR: Backup failed (fr=%d). Check SD card and path.\r\n", fr);
     }
@@ -29,17 +31,17 @@ void action_backup_flash(void) {
 void action_restore_flash(void) {
     printf("\r\n=== Restore SPI Flash ===\r\n");
 
-    // Safety checks: file exists, size matches capacity, JEDEC sanity
+    // Safety checks: file exists, image size matches capacity, JEDEC sanity
     FRESULT fr;
-    FILINFO fno;
-    fr = f_stat("0:/pico_test/flash_backup.bin", &fno);
+    uint32_t image_bytes = 0;
+    fr = flash_backup_image_bytes(FLASH_BACKUP_PATH, &image_bytes);
     if (fr != FR_OK) {
-        printf("ERROR: File not found: 0:/pico_test/flash_backup.bin (fr=%d)\r\n", fr);
+        printf("ERROR: File not found: %s (fr=%d)\r\n", FLASH_BACKUP_PATH, fr);
         return;
     }
-    if ((uint32_t)fno.fsize != FLASH_TOTAL_BYTES) {
-        printf("ERROR: File size (%lu) != FLASH_TOTAL_BYTES (%u). Aborting restore.\r\n",
-               (unsigned long)fno.fsize, (unsigned)FLASH_TOTAL_BYTES);
+    if (image_bytes != flash_capacity_bytes()) {
+        printf("ERROR: Image size (%lu) != flash capacity (%u). Aborting restore.\r\n",
+               (unsigned long)image_bytes, (unsigned)flash_capacity_bytes());
         return;
     }
 
@@ -48,8 +50,8 @@ void action_restore_flash(void) {
     printf("Current JEDEC: %02X %02X %02X\r\n", id[0], id[1], id[2]);
     // Optionally you can enforce a specific JEDEC here by comparing to your known chip.
 
-    // Do the restore with verification enabled
-    fr = flash_restore_from_file("0:/pico_test/flash_backup.bin", FLASH_TOTAL_BYTES, true);
+    // Do the restore with verification enabled, rewriting only changed sectors
+    fr = flash_restore_from_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), true, true);
     if (fr == FR_OK) {
         printf("Restore OK (verified).\r\n");
     } else {
@@ -57,6 +59,43 @@ void action_restore_flash(void) {
     }
 }
 
+void action_verify_flash(void) {
+    static flash_cmp_result_t res;
+    printf("\r\n=== Compare SPI Flash with Backup ===\r\n");
+    FRESULT fr = flash_compare_to_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), &res);
+    if (fr != FR_OK) {
+        printf("ERROR: Compare failed (fr=%d). Check SD card and path.\r\n", fr);
+    } else if (res.sectors_differ == 0) {
+        printf("Compare OK: flash matches %s\r\n", FLASH_BACKUP_PATH);
+    } else {
+        printf("Compare: %u sectors differ from %s\r\n", (unsigned)res.sectors_differ, FLASH_BACKUP_PATH);
+    }
+}
+
+static void serial_out(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void action_tune_clock(void) {
+    clock_tune_t t;
+    uint8_t id[3] = {0};
+    printf("\r\n=== Find Max Reliable SPI Clock (clobbers scratch) ===\r\n");
+    read_jedec_id(id);
+    if (!clock_tune_run(&t, serial_out)) {
+        printf("ERROR: errors even at %u Hz; check wiring. Nothing saved.\r\n", (unsigned)SPI_FREQ_HZ);
+        return;
+    }
+    if (clock_tune_save(id, &t))
+        printf("Saved for JEDEC %02X%02X%02X -> %s\r\n", id[0], id[1], id[2], CLOCK_TUNE_PATH);
+    else
+        printf("WARNING: could not write %s\r\n", CLOCK_TUNE_PATH);
+    uint32_t hz = clock_tune_apply();
+    if (hz) printf("Flash now runs at %u Hz.\r\n", (unsigned)hz);
+}
+
 void action_show_network_status(void) {
     const bool wifi_up = wifi_is_connected();
     const bool http_up = http_server_is_running();
@@ -84,6 +123,11 @@ void print_menu(void) {
     printf("8: Show server status\r\n");
     printf("b: Backup Flash chip data to SD\r\n");
     printf("r: Restore Flash chip data from SD\r\n"); 
+    printf("v: Compare Flash chip with the SD backup (read-only)\r\n");
+    printf("m: Benchmark all flash chip selects and save\r\n");
+    printf("p: Run benchmark plan from SD (plan_custom.csv) and save\r\n");
+    printf("t: Find max reliable SPI clock for this chip and save\r\n");
+    printf("c: Read throughput vs transfer size (16B-64KB, whole chip) and save\r\n");
     printf("q: Quit\r\n");
     printf("> ");
 }
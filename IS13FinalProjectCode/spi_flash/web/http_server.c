@@ -5,6 +5,7 @@
 #include "web_pages.h"      // Add these includes
 #include "web_actions.h"
 #include "web_output.h"
+#include "bench.h"          // flash_bus_acquire()
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
 #include "lwip/pbuf.h"
@@ -68,6 +69,12 @@ typedef struct TCP_SERVER_T_ {
 
 static TCP_SERVER_T_ *s = NULL;
 
+// An upload holds the flash bus (and so the card) from its first packet
+// until the file is closed: finished, failed, or the connection dropped.
+static void upload_bus_release(const TCP_SERVER_T_ *st) {
+    if (!st || !st->uploading) flash_bus_release(FLASH_BUS_WEB);
+}
+
 /* ---------- close client ---------- */
 err_t tcp_server_close(void *arg) {
     TCP_SERVER_T_ *st = (TCP_SERVER_T_*)arg;
@@ -76,6 +83,7 @@ err_t tcp_server_close(void *arg) {
             f_close(&st->upload_file);
             f_mount(0, "", 0);
             st->uploading = false;
+            upload_bus_release(st);
             printf("Upload connection closed\n");
         }
 
@@ -396,6 +404,7 @@ static err_t tcp_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err
             f_close(&st->upload_file);
             f_mount(0, "", 0);
             st->uploading = false;
+            upload_bus_release(st);
             printf("Upload interrupted (connection closed)\n");
         }
         return tcp_server_close(arg);
@@ -407,6 +416,7 @@ static err_t tcp_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err
         size_t len = p->len;
         
         err_t result = process_upload_data(pcb, data, len);
+        upload_bus_release(st);
         pbuf_free(p);
         
         if (result == ERR_ABRT) {
@@ -433,8 +443,20 @@ static err_t tcp_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err
     req[p->tot_len] = '\0';
     tcp_recved(pcb, p->tot_len);
 
+    // The card is shared with serial actions and the core-1 run too
+    bool card = after_prefix(req, "POST /upload") || after_prefix(req, "GET /sd") ||
+                after_prefix(req, "GET /get");
+    if (card && !flash_bus_acquire(FLASH_BUS_WEB)) {
+        http_write_str(pcb, "HTTP/1.1 503 Service Unavailable\r\n\r\nFlash/SD busy; try again shortly.");
+        pbuf_free(p);
+        free(req);
+        tcp_output(pcb);
+        return tcp_server_close(arg);
+    }
+
     if (after_prefix(req, "POST /upload")) {
         err_t result = handle_upload(pcb, req, p->tot_len);
+        upload_bus_release(st);
         pbuf_free(p);
         free(req);
 
@@ -466,28 +488,38 @@ static err_t tcp_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err
     char cmd[64];
     if (get_qs_value(req, "cmd=", cmd, sizeof cmd)) {
         // Route to appropriate web action handler
-        if (strcmp(cmd, "test_conn") == 0) {
-            web_test_connection();
+        if (strcmp(cmd, "bench_status") == 0) {
+            web_benchmark_status();
         } else if (strcmp(cmd, "benchmark") == 0) {
-            web_run_benchmark();
-        } else if (strcmp(cmd, "benchmark_save") == 0) {
-            web_run_benchmark_save();
-        } else if (strcmp(cmd, "read_results") == 0) {
-            web_read_results();
-        } else if (strcmp(cmd, "benchmark_100") == 0) {
-            web_run_benchmark_100();
-        } else if (strcmp(cmd, "erase_last") == 0) {
-            web_erase_last_session();
-        } else if (strcmp(cmd, "identify_chip") == 0) {
-            web_identify_chip();
-        } else if (strcmp(cmd, "backup_flash") == 0) {
-            web_backup_flash();
-            send_action_result_page(pcb, cmd);
-        } else if (strcmp(cmd, "restore_flash") == 0) {
-            web_restore_flash();
-            send_action_result_page(pcb, cmd);
+            web_run_benchmark();            // claims the bus for core 1 itself
+        } else if (web_flash_busy()) {
+            // Core 1, a serial action or an upload has the flash bus; web_flash_busy() filled in the page
         } else {
-            web_printf("Unknown command: %s", cmd);
+            // web_flash_busy() claimed the bus for this action
+            if (strcmp(cmd, "test_conn") == 0) {
+                web_test_connection();
+            } else if (strcmp(cmd, "benchmark_save") == 0) {
+                web_run_benchmark_save();
+            } else if (strcmp(cmd, "read_results") == 0) {
+                web_read_results();
+            } else if (strcmp(cmd, "benchmark_100") == 0) {
+                web_run_benchmark_100();
+            } else if (strcmp(cmd, "erase_last") == 0) {
+                web_erase_last_session();
+            } else if (strcmp(cmd, "identify_chip") == 0) {
+                web_identify_chip();
+            } else if (strcmp(cmd, "backup_flash") == 0) {
+                web_backup_flash();
+                send_action_result_page(pcb, cmd);
+            } else if (strcmp(cmd, "restore_flash") == 0) {
+                web_restore_flash();
+                send_action_result_page(pcb, cmd);
+            } else if (strcmp(cmd, "verify_flash") == 0) {
+                web_verify_flash();
+            } else {
+                web_printf("Unknown command: %s", cmd);
+            }
+            flash_bus_release(FLASH_BUS_WEB);
         }
         send_action_result_page(pcb, cmd);
     } else {
@@ -499,6 +531,7 @@ static err_t tcp_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err
     } else {
         send_home_page(pcb);  // From web_pages.c
     }
+    if (card) flash_bus_release(FLASH_BUS_WEB);
 
     pbuf_free(p);
     free(req);
@@ -517,6 +550,8 @@ static err_t tcp_server_accept(void *arg, struct tcp_pcb *client_pcb, err_t err)
         printf("Cleaning up previous upload state\n");
         f_close(&s->upload_file);
         f_mount(0, "", 0);
+        s->uploading = false;
+        upload_bus_release(s);
     }
     
     reset_upload_state(); // Reset all upload state
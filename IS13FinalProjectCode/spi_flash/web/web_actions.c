@@ -117,10 +117,48 @@ void web_identify_chip(void) {
 
 void web_run_benchmark(void) {
     reset_web_output();
-    run_fast_benchmark_with_output(web_printf);
+    if (start_benchmark()) {
+        web_printf("=== Fast Benchmark started on Core 1 ===\r\n\r\n");
+    } else if (flash_bus_owner() == FLASH_BUS_CORE1) {
+        web_printf("=== Fast Benchmark already running (%d%%) ===\r\n\r\n", get_benchmark_progress());
+    } else {
+        web_printf("=== Flash busy with a serial menu action; benchmark not started ===\r\n\r\n");
+    }
+    web_printf("Progress and results: http://<PICO_IP>/action?cmd=bench_status\r\n");
+    web_print_back_to_menu();
+}
+
+void web_benchmark_status(void) {
+    static char results[6144];
+    char status[64];
+    reset_web_output();
+    get_benchmark_status(status, sizeof status);
+    web_printf("=== Fast Benchmark (Core 1) ===\r\n\r\n");
+    web_printf("Status: %s\r\nProgress: %d%%\r\n\r\n", status, get_benchmark_progress());
+    if (!is_benchmark_running() && !is_benchmark_complete()) {
+        web_printf("No benchmark has run yet. Use 2. Run Benchmark.\r\n");
+    } else {
+        get_benchmark_results(results, sizeof results);
+        web_printf("%s", results);
+        if (is_benchmark_running())
+            web_printf("\r\nStill running; reload this page for more.\r\n");
+    }
     web_print_back_to_menu();
 }
 
+bool web_flash_busy(void) {
+    if (flash_bus_acquire(FLASH_BUS_WEB)) return false;
+    reset_web_output();
+    if (flash_bus_owner() == FLASH_BUS_CORE1) {
+        web_printf("Flash busy: the Core 1 benchmark is %d%% done.\r\n", get_benchmark_progress());
+        web_printf("Watch it at http://<PICO_IP>/action?cmd=bench_status and try again when it finishes.\r\n");
+    } else {
+        web_printf("Flash busy: a serial menu action is running. Try again when it finishes.\r\n");
+    }
+    web_print_back_to_menu();
+    return true;
+}
+
 void web_run_benchmark_save(void) {
     reset_web_output();
     web_printf("=== Running Benchmark + Save ===\r\n\r\n");
@@ -157,22 +195,23 @@ void web_show_status(void) {
     web_printf("WiFi: %s\r\n", wifi_is_connected() ? "Connected" : "Disconnected");
     web_printf("IP: %s\r\n", wifi_get_ip_str());
     web_printf("HTTP Server: %s\r\n", http_server_is_running() ? "Running" : "Stopped");
-    web_printf("SD Card: %s\r\n", sd_ok() ? "Connected" : "Not Connected");
+    web_printf("SD Card: %s\r\n", sd_status_name(sd_status()));
     web_print_back_to_menu();
 }
 
 void web_backup_flash(void) {
     reset_web_output();
     web_printf("=== Backing Up Flash to SD Card ===\r\n\r\n");
-    web_printf("Starting backup of 4MB flash chip...\r\n");
+    uint32_t bytes = flash_capacity_bytes();
+    web_printf("Starting backup of %uKB flash chip...\r\n", (unsigned)(bytes / 1024u));
     web_printf("This may take 1-2 minutes.\r\n\r\n");
     
-    FRESULT fr = flash_backup_to_file("0:/pico_test/flash_backup.bin", FLASH_SIZE_BYTES);
+    FRESULT fr = flash_backup_to_file(FLASH_BACKUP_PATH, bytes, FLASH_BACKUP_COMPRESS);
     
     if (fr == FR_OK) {
         web_printf("\r\n✓ Backup successful!\r\n");
-        web_printf("File saved: /pico_test/flash_backup.bin\r\n");
-        web_printf("Size: 4 MB (4,194,304 bytes)\r\n");
+        web_printf("File saved: %s\r\n", FLASH_BACKUP_PATH + 2);   // drop the "0:"
+        web_printf("Size: %u KB (%u bytes) of flash\r\n", (unsigned)(bytes / 1024u), (unsigned)bytes);
     } else {
         web_printf("\r\n✗ Backup failed (error %d)\r\n", fr);
         web_printf("Check SD card connection.\r\n");
@@ -186,7 +225,7 @@ void web_restore_flash(void) {
     web_printf("Starting restore from backup file...\r\n");
     web_printf("This may take 2-3 minutes.\r\n\r\n");
     
-    FRESULT fr = flash_restore_from_file("0:/pico_test/flash_backup.bin", FLASH_SIZE_BYTES, true);
+    FRESULT fr = flash_restore_from_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), true, true);
     
     if (fr == FR_OK) {
         web_printf("\r\n✓ Restore successful!\r\n");
@@ -195,4 +234,20 @@ void web_restore_flash(void) {
         web_printf("\r\n✗ Restore failed (error %d)\r\n", fr);
         web_printf("Check SD card and backup file.\r\n");
     }
-}
\ No newline at end of file
+}
+
+void web_verify_flash(void) {
+    static flash_cmp_result_t res;
+    reset_web_output();
+    web_printf("=== Comparing Flash with SD Backup ===\r\n\r\n");
+    web_printf("Read-only: the chip is not modified.\r\n\r\n");
+
+    FRESULT fr = flash_compare_to_file(FLASH_BACKUP_PATH, flash_capacity_bytes(), &res);
+
+    if (fr == FR_OK) {
+        flash_cmp_print_map(&res, web_printf);
+    } else {
+        web_printf("\r\n✗ Compare failed (error %d)\r\n", fr);
+        web_printf("Check SD card and backup file.\r\n");
+    }
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "web_output.h"
 #include "net.h"
 #include "http_server.h"
+#include "bench.h"          // flash_bus_owner()
 #include "ff.h"
 #include <string.h>
 #include <stdio.h>
@@ -33,11 +34,16 @@ static void url_decode(char *s){
 
 
 /* ---------- tiny SD probe ---------- */
-bool sd_ok(void) {
+sd_status_t sd_status(void) {
+    if (flash_bus_owner() != FLASH_BUS_FREE) return SD_IN_USE;
     FATFS fs;
     FRESULT fr = f_mount(&fs, "0:", 1);
-    if (fr == FR_OK) { f_mount(0, "", 0); return true; }
-    return false;
+    if (fr == FR_OK) { f_mount(0, "", 0); return SD_PRESENT; }
+    return SD_ABSENT;
+}
+
+const char *sd_status_name(sd_status_t st) {
+    return st == SD_PRESENT ? "Connected" : st == SD_IN_USE ? "In use" : "Not Connected";
 }
 
 /* ---------- 200/404 headers ---------- */
@@ -56,9 +62,9 @@ static const char *HTTP404 =
 void send_home_page(struct tcp_pcb *pcb) {
     http_write_str(pcb, HTTP200);
 
-    bool ok = sd_ok();
-    const char *sd_status = ok ? "Connected" : "Not Connected";
-    const char *sd_class  = ok ? "info" : "error";
+    sd_status_t sd = sd_status();
+    const char *sd_name  = sd_status_name(sd);
+    const char *sd_class = sd != SD_ABSENT ? "info" : "error";
 
     char html[4096];
     snprintf(html, sizeof html,
@@ -94,7 +100,7 @@ void send_home_page(struct tcp_pcb *pcb) {
         "</div>"
         "<p>Upload files directly to your SD card via WiFi!</p>"
         "</body></html>",
-        sd_class, sd_status);
+        sd_class, sd_name);
 
     http_write_str(pcb, html);
 }
@@ -125,6 +131,7 @@ void send_web_menu(struct tcp_pcb *pcb) {
         "<h1>SPI Flash Tool - Web Interface</h1>");
     
     // Status panel
+    sd_status_t sd = sd_status();
     char buf[1024];
     snprintf(buf, sizeof buf,
         "<div class='panel'>"
@@ -139,8 +146,8 @@ void send_web_menu(struct tcp_pcb *pcb) {
         wifi_get_ip_str(),
         http_server_is_running() ? "online" : "offline",
         http_server_is_running() ? "Running" : "Stopped",
-        sd_ok() ? "online" : "offline",
-        sd_ok() ? "Connected" : "Not Connected"
+        sd != SD_ABSENT ? "online" : "offline",
+        sd_status_name(sd)
     );
     http_write_str(pcb, buf);
     
@@ -151,6 +158,7 @@ void send_web_menu(struct tcp_pcb *pcb) {
         "<h3>Quick Tests</h3>"
         "<a class='btn' href='/action?cmd=test_conn'>1. Test Connection</a>"
         "<a class='btn' href='/action?cmd=benchmark'>2. Run Benchmark</a>"
+        "<a class='btn' href='/action?cmd=bench_status'>Benchmark Progress</a>"
         "<a class='btn' href='/action?cmd=benchmark_100'>5. 100-run Demo</a>"
         "</div>"
         "<div class='menu-item'>"
@@ -170,7 +178,8 @@ void send_web_menu(struct tcp_pcb *pcb) {
         "<p style='color:#c22;font-weight:bold'>IMPORTANT: Click button ONCE and wait. Do NOT refresh!</p>"
         "<a class='btn' href='/action?cmd=backup_flash'>Backup Flash to SD</a>"
         "<a class='btn btn-danger' href='/action?cmd=restore_flash' onclick='return confirm(\"OVERWRITE flash chip?\")'>Restore Flash from SD</a>"
-        "<p style='font-size:12px;color:#666;margin:8px 0'>Backup: ~60 seconds | Restore: ~2-3 minutes (DESTRUCTIVE!)</p>"
+        "<a class='btn' href='/action?cmd=verify_flash'>Compare Flash with SD</a>"
+        "<p style='font-size:12px;color:#666;margin:8px 0'>Backup: ~60 seconds | Restore: ~2-3 minutes (DESTRUCTIVE!) | Compare: read-only</p>"
         "</div>"
         "<div class='menu-item'>"
         "<h3>File Management</h3>"